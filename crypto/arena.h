@@ -0,0 +1,166 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Quasis (info@quasis.io)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+#include <new>
+#include <vector>
+#include <utility>
+#include <string.h>
+
+namespace crypto
+{
+    // Arena<object_t, COUNT> hands out objects from slabs of COUNT slots,
+    // each slot aligned as object_t requires. Released slots go on an
+    // intrusive free list and are reused first; fresh slots are carved off
+    // the newest slab in address order, so memory is only touched when it
+    // is used. Slabs are returned to the system only by the destructor.
+    // An arena is not thread-safe: keep one per thread
+
+    template<class object_t, size_t COUNT = 4096>
+    class Arena
+    {
+        union Slot
+        {
+            Slot           *next;
+            alignas(object_t) unsigned char data[sizeof(object_t)];
+        };
+
+        std::vector<Slot*>  m_slabs;
+        Slot               *m_free;
+        size_t              m_next;
+        size_t              m_size;
+
+
+    public:
+
+        Arena() : m_free{ nullptr }, m_next{ COUNT }, m_size{ 0 }
+        {
+        }
+
+
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+
+        // objects still alive are not destroyed, but their memory is wiped
+        // before the slabs are released
+
+       ~Arena()
+        {
+            for (Slot *slab : this->m_slabs)
+            {
+                memset((void*)slab, 0, COUNT * sizeof(Slot));
+                ::operator delete(slab, std::align_val_t(alignof(Slot)));
+            }
+        }
+
+
+        size_t
+        size() const
+        {
+            return this->m_size;
+        }
+
+
+        size_t
+        capacity() const
+        {
+            return this->m_slabs.size() * COUNT;
+        }
+
+
+        // create() takes its slot only once the constructor has returned,
+        // so a constructor that throws leaves the free list and the slab as
+        // they were
+
+        template<class... args_t> object_t*
+        create(args_t&&... args)
+        {
+            Slot *slot = this->m_free, *next = nullptr;
+
+            if (slot)
+            {
+                next = slot->next;
+            }
+            else
+            {
+                if (this->m_next == COUNT)
+                {
+                    if (this->m_slabs.size() == this->m_slabs.capacity())
+                    {
+                        this->m_slabs.reserve(2 * this->m_slabs.size() + 1);
+                    }
+
+                    this->m_slabs.push_back((Slot*)::operator new(COUNT * sizeof(Slot), std::align_val_t(alignof(Slot))));
+                    this->m_next = 0;
+                }
+
+                slot = this->m_slabs.back() + this->m_next;
+            }
+
+            object_t *object;
+
+            try
+            {
+                object = new (slot->data) object_t(std::forward<args_t>(args)...);
+            }
+            catch (...)
+            {
+                if (slot == this->m_free)
+                {
+                    slot->next = next;
+                }
+
+                throw;
+            }
+
+            if (slot == this->m_free)
+            {
+                this->m_free = next;
+            }
+            else
+            {
+                ++this->m_next;
+            }
+
+            return ++this->m_size, object;
+        }
+
+
+        void
+        destroy(object_t *object)
+        {
+            if (object)
+            {
+                object->~object_t();
+
+                Slot *slot = (Slot*)object;
+                slot->next = this->m_free;
+                this->m_free = slot;
+                --this->m_size;
+            }
+        }
+    };
+}
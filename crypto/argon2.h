@@ -0,0 +1,654 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Quasis (info@quasis.io)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+#include <algorithm>
+#include "crypto/pool.h"
+#include "crypto/hasher/blake2.h"
+
+#if defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+#endif
+
+namespace crypto
+{
+    namespace argon2
+    {
+        enum : uint32_t
+        {
+            ARGON2D   =    0,
+            ARGON2I   =    1,
+            ARGON2ID  =    2,
+            VERSION   = 0x13,
+            SLICES    =    4,
+            WORDS     =  128,
+            ADDRESSES =  128,
+        };
+
+
+        // Block is one 1 KiB cell of the memory matrix, in native words
+
+        struct alignas(64) Block
+        {
+            uint64_t v[WORDS];
+        };
+
+
+        // hprime() is the variable-length hash H' built from BLAKE2b: up to
+        // 64 bytes it is BLAKE2b of that length, longer outputs chain 64-byte
+        // digests and keep the first half of each
+
+        inline void
+        hprime(void *output, const size_t &volume, const void *record, const size_t &length)
+        {
+            const uint8_t size[4] = { uint8_t(volume), uint8_t(volume >> 8), uint8_t(volume >> 16), uint8_t(volume >> 24) };
+            uint8_t      *memory  = (uint8_t*)output;
+            uint8_t       digest[64];
+            size_t        remain  = volume;
+
+            if (volume <= sizeof(digest))
+            {
+                hasher::BLAKE2b<>(volume).update({ { size, sizeof(size) }, { record, length } }).digest(digest);
+                memcpy(memory, digest, volume);
+                memset(digest, 0, sizeof(digest));
+                return;
+            }
+
+            hasher::BLAKE2b<>().update({ { size, sizeof(size) }, { record, length } }).digest(digest);
+
+            for (; remain > sizeof(digest); memory += 32, remain -= 32)
+            {
+                if (remain != volume)
+                {
+                    hasher::BLAKE2b<>().update(digest, sizeof(digest)).digest(digest);
+                }
+
+                memcpy(memory, digest, 32);
+            }
+
+            hasher::BLAKE2b<>(remain).update(digest, sizeof(digest)).digest(digest);
+            memcpy(memory, digest, remain);
+            memset(digest, 0, sizeof(digest));
+        }
+
+
+        // load() and store() move a block from and to its little-endian bytes
+
+        inline void
+        load(Block &block, const uint8_t *record)
+        {
+            memcpy(block.v, record, sizeof(block.v));
+
+            for (size_t i = 0; i < WORDS; ++i)
+            {
+                block.v[i] = le2h(block.v[i]);
+            }
+        }
+
+
+        inline void
+        store(uint8_t *record, const Block &block)
+        {
+            for (size_t i = 0; i < WORDS; ++i)
+            {
+                const uint64_t word = h2le(block.v[i]);
+                memcpy(record + i * sizeof(word), &word, sizeof(word));
+            }
+        }
+
+
+        // fill() computes next = G(prev, ref), or next ^= G(prev, ref) when
+        // xored. G xors its inputs into R, runs the BlaMka permutation P over
+        // the eight rows and then the eight columns of R, 16 words each, and
+        // xors the result with R once more. Every kernel reads both inputs
+        // before it writes next, so next may alias either of them
+
+        typedef void (*fill_t)(const Block&, const Block&, Block&, const bool&);
+
+
+        inline uint64_t
+        blamka(const uint64_t &x, const uint64_t &y)
+        {
+            return x + y + 2 * (x & 0xFFFFFFFF) * (y & 0xFFFFFFFF);
+        }
+
+
+        inline void
+        mix(uint64_t &a, uint64_t &b, uint64_t &c, uint64_t &d)
+        {
+            a = blamka(a, b); d = rotr(d ^ a, 32);
+            c = blamka(c, d); b = rotr(b ^ c, 24);
+            a = blamka(a, b); d = rotr(d ^ a, 16);
+            c = blamka(c, d); b = rotr(b ^ c, 63);
+        }
+
+
+        inline void
+        permute(uint64_t (&v)[16])
+        {
+            mix(v[0], v[4], v[ 8], v[12]);
+            mix(v[1], v[5], v[ 9], v[13]);
+            mix(v[2], v[6], v[10], v[14]);
+            mix(v[3], v[7], v[11], v[15]);
+            mix(v[0], v[5], v[10], v[15]);
+            mix(v[1], v[6], v[11], v[12]);
+            mix(v[2], v[7], v[ 8], v[13]);
+            mix(v[3], v[4], v[ 9], v[14]);
+        }
+
+
+        inline void
+        fillscalar(const Block &prev, const Block &ref, Block &next, const bool &xored)
+        {
+            uint64_t r[WORDS], t[WORDS], v[16];
+
+            for (size_t i = 0; i < WORDS; ++i)
+            {
+                r[i] = prev.v[i] ^ ref.v[i];
+                t[i] = xored ? r[i] ^ next.v[i] : r[i];
+            }
+
+            for (size_t i = 0; i < 8; ++i)
+            {
+                memcpy(v, r + 16 * i, sizeof(v));
+                permute(v);
+                memcpy(r + 16 * i, v, sizeof(v));
+            }
+
+            for (size_t i = 0; i < 8; ++i)
+            {
+                for (size_t k = 0; k < 8; ++k)
+                {
+                    v[2 * k] = r[16 * k + 2 * i]; v[2 * k + 1] = r[16 * k + 2 * i + 1];
+                }
+
+                permute(v);
+
+                for (size_t k = 0; k < 8; ++k)
+                {
+                    r[16 * k + 2 * i] = v[2 * k]; r[16 * k + 2 * i + 1] = v[2 * k + 1];
+                }
+            }
+
+            for (size_t i = 0; i < WORDS; ++i)
+            {
+                next.v[i] = r[i] ^ t[i];
+            }
+        }
+
+
+        #if defined(CRYPTO_X86)
+            // the AVX2 kernel holds the whole block in 32 registers of four
+            // words. A row is four consecutive registers, with the diagonal
+            // step done by rotating three of them across lanes. Two adjacent
+            // columns share eight registers, one 128-bit half each, and are
+            // regrouped into rows of four registers with permute2x128
+
+            CRYPTO_TARGET("avx2") inline __m256i
+            blamka(const __m256i &x, const __m256i &y)
+            {
+                const __m256i z = _mm256_mul_epu32(x, y);
+                return _mm256_add_epi64(_mm256_add_epi64(x, y), _mm256_add_epi64(z, z));
+            }
+
+
+            CRYPTO_TARGET("avx2") inline void
+            mix(__m256i &a, __m256i &b, __m256i &c, __m256i &d)
+            {
+                const __m256i r16 = _mm256_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9, 2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9);
+                const __m256i r24 = _mm256_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10, 3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10);
+
+                a = blamka(a, b); d = _mm256_shuffle_epi32(_mm256_xor_si256(d, a), 0xB1);
+                c = blamka(c, d); b = _mm256_shuffle_epi8(_mm256_xor_si256(b, c), r24);
+                a = blamka(a, b); d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), r16);
+                c = blamka(c, d); b = _mm256_xor_si256(b, c);
+                b = _mm256_xor_si256(_mm256_add_epi64(b, b), _mm256_srli_epi64(b, 63));
+            }
+
+
+            CRYPTO_TARGET("avx2") inline void
+            permute(__m256i &a, __m256i &b, __m256i &c, __m256i &d)
+            {
+                mix(a, b, c, d);
+
+                b = _mm256_permute4x64_epi64(b, 0x39);
+                c = _mm256_permute4x64_epi64(c, 0x4E);
+                d = _mm256_permute4x64_epi64(d, 0x93);
+
+                mix(a, b, c, d);
+
+                b = _mm256_permute4x64_epi64(b, 0x93);
+                c = _mm256_permute4x64_epi64(c, 0x4E);
+                d = _mm256_permute4x64_epi64(d, 0x39);
+            }
+
+
+            CRYPTO_TARGET("avx2") inline void
+            fillavx2(const Block &prev, const Block &ref, Block &next, const bool &xored)
+            {
+                __m256i r[32], t[32], q[8];
+
+                for (size_t i = 0; i < 32; ++i)
+                {
+                    r[i] = _mm256_xor_si256(_mm256_load_si256((const __m256i*)prev.v + i), _mm256_load_si256((const __m256i*)ref.v + i));
+                    t[i] = xored ? _mm256_xor_si256(r[i], _mm256_load_si256((const __m256i*)next.v + i)) : r[i];
+                }
+
+                for (size_t i = 0; i < 8; ++i)
+                {
+                    permute(r[4 * i], r[4 * i + 1], r[4 * i + 2], r[4 * i + 3]);
+                }
+
+                for (size_t j = 0; j < 4; ++j)
+                {
+                    for (size_t k = 0; k < 4; ++k)
+                    {
+                        q[k]     = _mm256_permute2x128_si256(r[8 * k + j], r[8 * k + 4 + j], 0x20);
+                        q[k + 4] = _mm256_permute2x128_si256(r[8 * k + j], r[8 * k + 4 + j], 0x31);
+                    }
+
+                    permute(q[0], q[1], q[2], q[3]);
+                    permute(q[4], q[5], q[6], q[7]);
+
+                    for (size_t k = 0; k < 4; ++k)
+                    {
+                        r[8 * k + j]     = _mm256_permute2x128_si256(q[k], q[k + 4], 0x20);
+                        r[8 * k + 4 + j] = _mm256_permute2x128_si256(q[k], q[k + 4], 0x31);
+                    }
+                }
+
+                for (size_t i = 0; i < 32; ++i)
+                {
+                    _mm256_store_si256((__m256i*)next.v + i, _mm256_xor_si256(r[i], t[i]));
+                }
+            }
+        #endif
+
+
+        // kernel() picks the fill function once, on first use
+
+        inline fill_t
+        kernel()
+        {
+            static const fill_t instance = []() -> fill_t
+            {
+                #if defined(CRYPTO_X86)
+                    if (cpu().avx2)    return &fillavx2;
+                #endif
+
+                return &fillscalar;
+            }();
+
+            return instance;
+        }
+
+
+        // Memory holds the matrix. A matrix of HUGEPAGE bytes or more asks
+        // for explicit huge pages first, MAP_HUGETLB or MEM_LARGE_PAGES,
+        // which need pages reserved by the administrator or a privilege;
+        // without them it falls back to normal pages, advised for
+        // transparent huge pages where the system has them. A pass reads
+        // the matrix at random, so 2 MiB pages save most of the TLB misses
+        // and page faults. The blocks are wiped before they are released
+
+        class Memory
+        {
+            Block          *m_blocks;
+            size_t          m_volume;
+            bool            m_huge;
+
+
+        public:
+
+            enum : size_t
+            {
+                HUGEPAGE = size_t(2) << 20,
+            };
+
+
+            explicit Memory(const size_t &count) : m_blocks{ nullptr }, m_volume{ count * sizeof(Block) }, m_huge{ false }
+            {
+                #if defined(_WIN32)
+                    const size_t large = GetLargePageMinimum();
+
+                    if (large && this->m_volume >= HUGEPAGE)
+                    {
+                        const size_t volume = (this->m_volume + large - 1) / large * large;
+
+                        if ((this->m_blocks = (Block*)VirtualAlloc(nullptr, volume, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE)))
+                        {
+                            this->m_volume = volume;
+                            this->m_huge   = true;
+                        }
+                    }
+
+                    if (!this->m_blocks)
+                    {
+                        this->m_blocks = (Block*)VirtualAlloc(nullptr, this->m_volume, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+                    }
+                #else
+                    void *memory = MAP_FAILED;
+
+                    if (this->m_volume >= HUGEPAGE)
+                    {
+                        this->m_volume = (this->m_volume + HUGEPAGE - 1) / HUGEPAGE * HUGEPAGE;
+
+                        #if defined(MAP_HUGETLB)
+                            memory = mmap(nullptr, this->m_volume, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+                            this->m_huge = memory != MAP_FAILED;
+                        #endif
+                    }
+
+                    if (memory == MAP_FAILED)
+                    {
+                        memory = mmap(nullptr, this->m_volume, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+                        #if defined(MADV_HUGEPAGE)
+                            if (memory != MAP_FAILED && this->m_volume >= HUGEPAGE)
+                            {
+                                madvise(memory, this->m_volume, MADV_HUGEPAGE);
+                            }
+                        #endif
+                    }
+
+                    this->m_blocks = memory != MAP_FAILED ? (Block*)memory : nullptr;
+                #endif
+            }
+
+
+            Memory(const Memory&) = delete;
+            Memory& operator=(const Memory&) = delete;
+
+
+           ~Memory()
+            {
+                if (this->m_blocks)
+                {
+                    memset(this->m_blocks, 0, this->m_volume);
+
+                    #if defined(_WIN32)
+                        VirtualFree(this->m_blocks, 0, MEM_RELEASE);
+                    #else
+                        munmap(this->m_blocks, this->m_volume);
+                    #endif
+                }
+            }
+
+
+            Block*
+            data() const
+            {
+                return this->m_blocks;
+            }
+
+
+            // huge() tells whether the matrix got explicit huge pages
+
+            bool
+            huge() const
+            {
+                return this->m_huge;
+            }
+        };
+    }
+
+
+    // Argon2 is the memory-hard password hash of RFC 9106, Argon2id by
+    // default. The matrix has one row per lane; the lanes of a slice run
+    // on the threads of the pool, and the pool returning from a slice is
+    // the synchronisation point all lanes wait at before the next one.
+    // Blocks are compressed by argon2::kernel(), four words per AVX2 lane
+
+    class Argon2
+    {
+        typedef argon2::Block Block;
+
+        uint32_t        m_passes;
+        uint32_t        m_memory;
+        uint32_t        m_lanes;
+        uint32_t        m_type;
+        Pool           &m_pool;
+
+
+    public:
+
+        // memory is in KiB, one block each, and is rounded down to a
+        // multiple of 4 * lanes
+
+        Argon2(const uint32_t &passes, const uint32_t &memory, const uint32_t &lanes, const uint32_t &type = argon2::ARGON2ID, Pool &pool = Pool::shared())
+            : m_passes{ passes }, m_memory{ memory }, m_lanes{ lanes }, m_type{ type }, m_pool(pool)
+        {
+        }
+
+
+        // derive() writes volume bytes of tag for a password and salt, with
+        // an optional secret and associated data. It returns false for
+        // parameters RFC 9106 rules out or when the matrix cannot be mapped
+
+        bool
+        derive(const void *password, const size_t &size, const void *salt, const size_t &length, void *output, const size_t &volume,
+               const void *secret = nullptr, const size_t &secretlen = 0, const void *data = nullptr, const size_t &datalen = 0) const
+        {
+            const uint32_t segment = this->m_lanes ? this->m_memory / (argon2::SLICES * this->m_lanes) : 0;
+            const uint32_t lane    = segment * argon2::SLICES;
+
+            if (this->m_passes < 1 || this->m_lanes < 1 || this->m_lanes > 0xFFFFFF || this->m_memory < 8 * uint64_t(this->m_lanes) || this->m_type > argon2::ARGON2ID)
+            {
+                return false;
+            }
+
+            if (volume < 4 || volume > UINT32_MAX || size > UINT32_MAX || length > UINT32_MAX || secretlen > UINT32_MAX || datalen > UINT32_MAX)
+            {
+                return false;
+            }
+
+            argon2::Memory memory(size_t(lane) * this->m_lanes);
+            Block         *blocks = memory.data();
+            uint8_t        seed[72], bytes[sizeof(Block)];
+
+            if (!blocks)
+            {
+                return false;
+            }
+
+            {
+                hasher::BLAKE2b<> hasher;
+
+                auto word = [&](const size_t &number)
+                {
+                    const uint8_t le[4] = { uint8_t(number), uint8_t(number >> 8), uint8_t(number >> 16), uint8_t(number >> 24) };
+                    hasher.update(le, sizeof(le));
+                };
+
+                word(this->m_lanes); word(volume); word(this->m_memory); word(this->m_passes); word(argon2::VERSION); word(this->m_type);
+                word(size);      hasher.update(password, size);
+                word(length);    hasher.update(salt, length);
+                word(secretlen); hasher.update(secret, secretlen);
+                word(datalen);   hasher.update(data, datalen);
+                hasher.digest(seed);
+            }
+
+            this->m_pool.run(this->m_lanes, 1, [&](size_t begin, size_t end)
+            {
+                uint8_t local[sizeof(seed)], block[sizeof(Block)];
+
+                memcpy(local, seed, 64);
+
+                for (size_t l = begin; l < end; ++l)
+                {
+                    for (uint32_t c = 0; c < 2; ++c)
+                    {
+                        for (size_t i = 0; i < 4; ++i)
+                        {
+                            local[64 + i] = uint8_t(c >> (8 * i));
+                            local[68 + i] = uint8_t(l >> (8 * i));
+                        }
+
+                        argon2::hprime(block, sizeof(block), local, sizeof(local));
+                        argon2::load(blocks[l * lane + c], block);
+                    }
+                }
+
+                memset(local, 0, sizeof(local));
+                memset(block, 0, sizeof(block));
+            });
+
+            for (uint32_t pass = 0; pass < this->m_passes; ++pass)
+            {
+                for (uint32_t slice = 0; slice < argon2::SLICES; ++slice)
+                {
+                    this->m_pool.run(this->m_lanes, 1, [&](size_t begin, size_t end)
+                    {
+                        for (size_t l = begin; l < end; ++l)
+                        {
+                            this->fill(blocks, lane, segment, pass, uint32_t(l), slice);
+                        }
+                    });
+                }
+            }
+
+            Block last = blocks[lane - 1];
+
+            for (size_t l = 1; l < this->m_lanes; ++l)
+            {
+                for (size_t i = 0; i < argon2::WORDS; ++i)
+                {
+                    last.v[i] ^= blocks[l * lane + lane - 1].v[i];
+                }
+            }
+
+            argon2::store(bytes, last);
+            argon2::hprime(output, volume, bytes, sizeof(bytes));
+
+            memset(&last, 0, sizeof(last));
+            memset(bytes, 0, sizeof(bytes));
+            memset(seed, 0, sizeof(seed));
+            return true;
+        }
+
+
+    protected:
+
+        // fill() computes one segment of one lane, as in section 3.4 of
+        // RFC 9106. Reference blocks come from the address blocks in the
+        // first half of the first pass of Argon2id, and from the previous
+        // block otherwise
+
+        void
+        fill(Block *blocks, const uint32_t &lane, const uint32_t &segment, const uint32_t &pass, const uint32_t &l, const uint32_t &slice) const
+        {
+            const argon2::fill_t compress = argon2::kernel();
+            const bool           xored    = pass > 0;
+            const bool           address  = this->m_type == argon2::ARGON2I || (this->m_type == argon2::ARGON2ID && pass == 0 && slice < argon2::SLICES / 2);
+            const uint32_t       start    = pass == 0 && slice == 0 ? 2 : 0;
+
+            Block zero{}, input{}, addresses{};
+            Block *row = blocks + size_t(l) * lane;
+
+            if (address)
+            {
+                input.v[0] = pass;
+                input.v[1] = l;
+                input.v[2] = slice;
+                input.v[3] = uint64_t(lane) * this->m_lanes;
+                input.v[4] = this->m_passes;
+                input.v[5] = this->m_type;
+
+                if (start)
+                {
+                    next(input, addresses, zero, compress);
+                }
+            }
+
+            for (uint32_t i = start; i < segment; ++i)
+            {
+                const uint32_t index = slice * segment + i;
+                const Block   &prev  = row[index ? index - 1 : lane - 1];
+                uint64_t       random;
+
+                if (address)
+                {
+                    if (i % argon2::ADDRESSES == 0)
+                    {
+                        next(input, addresses, zero, compress);
+                    }
+
+                    random = addresses.v[i % argon2::ADDRESSES];
+                }
+                else
+                {
+                    random = prev.v[0];
+                }
+
+                const uint32_t other = pass == 0 && slice == 0 ? l : uint32_t((random >> 32) % this->m_lanes);
+                const bool     same  = other == l;
+                uint64_t       area;
+
+                if (pass == 0)
+                {
+                    area = slice == 0 ? i - 1 : same ? uint64_t(slice) * segment + i - 1 : uint64_t(slice) * segment - (i == 0);
+                }
+                else
+                {
+                    area = same ? uint64_t(lane) - segment + i - 1 : uint64_t(lane) - segment - (i == 0);
+                }
+
+                uint64_t relative = random & 0xFFFFFFFF;
+
+                relative = relative * relative >> 32;
+                relative = area - 1 - (area * relative >> 32);
+
+                const uint64_t first = pass == 0 || slice == argon2::SLICES - 1 ? 0 : uint64_t(slice + 1) * segment;
+                const Block   &ref   = blocks[size_t(other) * lane + (first + relative) % lane];
+
+                compress(prev, ref, row[index], xored);
+            }
+
+            memset(&addresses, 0, sizeof(addresses));
+        }
+
+
+        // next() steps the counter of the input block and computes the next
+        // address block, G(zero, G(zero, input))
+
+        static void
+        next(Block &input, Block &addresses, const Block &zero, const argon2::fill_t &compress)
+        {
+            input.v[6]++;
+            compress(zero, input, addresses, false);
+            compress(zero, addresses, addresses, false);
+        }
+    };
+
+
+    inline bool
+    argon2id(const void *password, const size_t &size, const void *salt, const size_t &length, const uint32_t &passes,
+             const uint32_t &memory, const uint32_t &lanes, void *output, const size_t &volume, Pool &pool = Pool::shared())
+    {
+        return Argon2(passes, memory, lanes, argon2::ARGON2ID, pool).derive(password, size, salt, length, output, volume);
+    }
+}
@@ -0,0 +1,133 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Quasis (info@quasis.io)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+    #define CRYPTO_X86
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #else
+        #include <cpuid.h>
+    #endif
+    #include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+    #define CRYPTO_TARGET(features)
+#else
+    #define CRYPTO_TARGET(features) __attribute__((target(features)))
+#endif
+
+namespace crypto
+{
+    struct CPU
+    {
+        bool sse2;
+        bool ssse3;
+        bool sse41;
+        bool avx;
+        bool avx2;
+        bool bmi2;
+        bool sha;
+        bool avx512;
+
+
+        static CPU
+        detect()
+        {
+            CPU result{};
+
+            #if defined(CRYPTO_X86)
+                uint32_t leaf1[4]{}, leaf7[4]{};
+                uint64_t xcr0{};
+
+                if (cpuid(0, leaf1) >= 7)
+                {
+                    cpuid(7, leaf7);
+                }
+
+                cpuid(1, leaf1);
+
+                if (leaf1[2] & (1u << 27))
+                {
+                    #if defined(_MSC_VER)
+                        xcr0 = _xgetbv(0);
+                    #else
+                        uint32_t eax, edx;
+                        __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+                        xcr0 = (uint64_t(edx) << 32) | eax;
+                    #endif
+                }
+
+                const bool ymm = (xcr0 & 0x06) == 0x06;
+                const bool zmm = (xcr0 & 0xE6) == 0xE6;
+
+                result.sse2   = (leaf1[3] & (1u << 26)) != 0;
+                result.ssse3  = (leaf1[2] & (1u <<  9)) != 0;
+                result.sse41  = (leaf1[2] & (1u << 19)) != 0;
+                result.avx    = (leaf1[2] & (1u << 28)) != 0 && ymm;
+                result.avx2   = (leaf7[1] & (1u <<  5)) != 0 && result.avx;
+                result.bmi2   = (leaf7[1] & (1u <<  8)) != 0;
+                result.sha    = (leaf7[1] & (1u << 29)) != 0 && result.sse41 && result.ssse3;
+                result.avx512 = (leaf7[1] & (1u << 16)) != 0 && (leaf7[1] & (1u << 30)) != 0 && result.avx2 && zmm;
+            #endif
+
+            return result;
+        }
+
+
+    private:
+
+        #if defined(CRYPTO_X86)
+            static uint32_t
+            cpuid(const uint32_t &leaf, uint32_t (&regs)[4])
+            {
+                #if defined(_MSC_VER)
+                    int data[4];
+                    __cpuidex(data, int(leaf), 0);
+                    for (size_t i = 0; i < 4; ++i) regs[i] = uint32_t(data[i]);
+                #else
+                    __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+                #endif
+
+                return regs[0];
+            }
+        #endif
+    };
+
+
+    // cpu()
+
+
+    inline const CPU&
+    cpu()
+    {
+        static const CPU instance = CPU::detect();
+        return instance;
+    }
+}
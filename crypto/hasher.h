@@ -24,12 +24,135 @@
  */
 
 #pragma once
+#include <utility>
+#include <initializer_list>
 #include "crypto/number.h"
 #include "crypto/string.h"
 
 namespace crypto
 {
-    template<size_t BITS, size_t VITS = BITS>
+    // a (pointer, length) pair describing one message of a batch
+
+    struct Slice
+    {
+        const void     *record;
+        size_t          length;
+    };
+
+
+    // Hasher<BITS, VITS> is the type-erased interface: every call goes through
+    // the vtable, so hashers of one width can be held by pointer or reference
+
+    template<size_t BITS, size_t VITS = BITS, class hasher_t = void>
+    class Hasher;
+
+
+    template<size_t BITS, size_t VITS>
+    class Hasher<BITS, VITS, void>
+    {
+    protected:
+
+        typedef uint8_t byte_t;
+
+
+    public:
+
+        typedef Number<VITS> digest_t;
+
+
+        virtual
+       ~Hasher()
+        {
+        }
+
+
+        virtual const size_t&
+        size() const = 0;
+
+
+        template<size_t length> Hasher&
+        update(const Number<length> &number)
+        {
+            return update(number.data(), number.size());
+        }
+
+
+        template<class char_t> Hasher&
+        update(const String<char_t> &string)
+        {
+            return update(string.data(), string.size());
+        }
+
+
+        Hasher&
+        update(const char *record)
+        {
+            return update((void*)record, strlen(record));
+        }
+
+
+        template<class data_t> Hasher&
+        update(const data_t &object)
+        {
+            return update((byte_t*)&object, sizeof(object));
+        }
+
+
+        Hasher&
+        update(const Slice *slices, const size_t &count)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                update(slices[i].record, slices[i].length);
+            }
+
+            return *this;
+        }
+
+
+        Hasher&
+        update(std::initializer_list<Slice> slices)
+        {
+            return update(slices.begin(), slices.size());
+        }
+
+
+        virtual Hasher&
+        update(const void *record, const size_t &length) = 0;
+
+
+        virtual Hasher&
+        update(const size_t &length, const byte_t &record) = 0;
+
+
+        virtual digest_t
+        digest() = 0;
+
+
+        virtual void
+        digest(void *record) = 0;
+
+
+        virtual Hasher&
+        reset() = 0;
+
+
+        virtual String<>
+        save() const = 0;
+
+
+        virtual bool
+        load(const void *record, const size_t &length) = 0;
+    };
+
+
+    // Hasher<BITS, VITS, hasher_t> is the static base of hasher_t, which
+    // supplies hash(), data(), capacity(), compress(block, count),
+    // initialize() and finalize(). Nothing is virtual; update() compresses
+    // whole blocks straight from the caller's memory and buffers only head
+    // and tail
+
+    template<size_t BITS, size_t VITS, class hasher_t>
     class Hasher
     {
         size_t          m_tail;
@@ -41,140 +164,172 @@ namespace crypto
         typedef uint8_t byte_t;
 
 
-    public:
-
-        Hasher() : m_tail{ 0 }, m_size{ 0 }
+        hasher_t&
+        self()
         {
+            return static_cast<hasher_t&>(*this);
         }
 
 
-        virtual
-       ~Hasher()
+        const hasher_t&
+        self() const
         {
-            this->m_tail = this->m_size = 0;
+            return static_cast<const hasher_t&>(*this);
         }
 
 
-        virtual const byte_t*
-        hash() const
+        // close() finalizes the hasher once, for digest() and for hashers
+        // with outputs of their own such as the squeeze of SHAKE
+
+        void
+        close()
         {
-            return nullptr;
+            if (this->size() < SIZE_MAX)
+            {
+                self().finalize();
+                this->m_size = SIZE_MAX;
+            }
         }
 
 
-        const size_t&
-        size() const
+    public:
+
+        typedef Hasher<BITS, VITS, void> erased_t;
+
+
+        Hasher() : m_tail{ 0 }, m_size{ 0 }
         {
-            return this->m_size;
         }
 
 
-        virtual byte_t*
-        data()
+       ~Hasher()
         {
-            return nullptr;
+            this->m_tail = this->m_size = 0;
         }
 
 
-        virtual const byte_t*
-        data() const
+        const size_t&
+        size() const
         {
-            return nullptr;
+            return this->m_size;
         }
 
 
         byte_t*
         begin()
         {
-            return this->data();
+            return self().data();
         }
 
 
         const byte_t*
         begin() const
         {
-            return this->data();
+            return self().data();
         }
 
 
         byte_t*
         end()
         {
-            return this->data() + this->m_tail;
+            return self().data() + this->m_tail;
         }
 
 
         const byte_t*
         end() const
         {
-            return this->data() + this->m_tail;
-        }
-
-
-        virtual size_t
-        capacity() const
-        {
-            return 0;
+            return self().data() + this->m_tail;
         }
 
 
         size_t
         reserve() const
         {
-            return this->capacity() - this->m_tail;
+            return self().capacity() - this->m_tail;
         }
 
 
-        template<size_t length> Hasher&
+        template<size_t length> hasher_t&
         update(const Number<length> &number)
         {
             return update(number.data(), number.size());
         }
 
 
-        template<class char_t> Hasher&
+        template<class char_t> hasher_t&
         update(const String<char_t> &string)
         {
             return update(string.data(), string.size());
         }
 
 
-        Hasher&
+        hasher_t&
         update(const char *record)
         {
             return update((void*)record, strlen(record));
         }
 
 
-        template<class data_t> Hasher&
+        template<class data_t> hasher_t&
         update(const data_t &object)
         {
             return update((byte_t*)&object, sizeof(object));
         }
 
 
-        Hasher&
+        hasher_t&
         update(const void *record, const size_t &length)
         {
-            size_t  volume , remain = length;
-            byte_t *memory = (byte_t*)record;
+            const size_t  block  = self().capacity();
+            const byte_t *memory = (const byte_t*)record;
+            size_t        volume , remain = length;
 
             assert(this->size() < SIZE_MAX);
 
-            while ((volume = this->reserve()) <= remain)
+            if (this->m_tail && (volume = this->reserve()) <= remain)
             {
                 memcpy(this->end(), memory, volume);
-                this->m_tail = (this->compress(), 0);
-                memory += volume; remain -= volume;
+                self().compress(self().data(), 1);
+                memory += volume; remain -= volume; this->m_tail = 0;
+            }
+
+            if (this->m_tail == 0 && remain >= block)
+            {
+                volume = remain / block;
+                self().compress(memory, volume);
+                memory += volume * block; remain -= volume * block;
             }
 
             memcpy(this->end(), memory, remain);
             m_tail += remain; m_size += length;
-            return *this;
+            return self();
         }
 
 
-        Hasher&
+        // update() over scattered segments: each one takes the zero-copy
+        // path, so only a block straddling two segments is copied
+
+        hasher_t&
+        update(const Slice *slices, const size_t &count)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                update(slices[i].record, slices[i].length);
+            }
+
+            return self();
+        }
+
+
+        hasher_t&
+        update(std::initializer_list<Slice> slices)
+        {
+            return update(slices.begin(), slices.size());
+        }
+
+
+        hasher_t&
         update(const size_t &length, const byte_t &record)
         {
             size_t  volume, remain = length;
@@ -184,41 +339,214 @@ namespace crypto
             while ((volume = this->reserve()) <= remain)
             {
                 memset(this->end(), record, volume);
-                this->m_tail = (this->compress(), 0);
-                remain -= volume;
+                self().compress(self().data(), 1);
+                this->m_tail = 0; remain -= volume;
             }
 
             memset(this->end(), record, remain);
             m_tail += remain; m_size += length;
-            return *this;
+            return self();
         }
 
 
         Number<VITS>
         digest()
         {
+            this->close();
+            return Number<VITS>(self().hash());
+        }
+
+
+        // digest() into a caller buffer of VITS / 8 bytes, without the
+        // Number temporary; reset() reloads the seed in place, so a hot
+        // loop can reuse one hasher instead of constructing a new one
+
+        void
+        digest(void *record)
+        {
+            this->close();
+            memcpy(record, self().hash(), VITS / CHAR_BIT);
+        }
+
+
+        hasher_t&
+        reset()
+        {
+            self().initialize();
+            this->m_tail = this->m_size = 0;
+            return self();
+        }
+
+
+        // save() writes the running state as a checkpoint: a version byte,
+        // the algorithm kind, BITS and VITS, the byte count, the chaining
+        // words and the unprocessed tail, all little-endian. A hasher that
+        // load()s it continues as if it had seen the same bytes; copying a
+        // hasher is the cheaper clone within one process
+
+        String<>
+        save() const
+        {
+            String<> record;
+
             if (this->size() < SIZE_MAX)
             {
-                this->finalize();
-                this->m_size = SIZE_MAX;
+                record.resize(HEADER + hasher_t::PACKED + this->m_tail);
+                byte_t *memory = (byte_t*)&record[0];
+
+                memory[0] = VERSION;
+                memory[1] = hasher_t::KIND;
+
+                for (size_t i = 0; i < 2; ++i)
+                {
+                    memory[2 + i] = byte_t(BITS >> (8 * i));
+                    memory[4 + i] = byte_t(VITS >> (8 * i));
+                }
+
+                for (size_t i = 0; i < 8; ++i)
+                {
+                    memory[6 + i] = byte_t(uint64_t(this->m_size) >> (8 * i));
+                }
+
+                self().pack(memory + HEADER);
+                memcpy(memory + HEADER + hasher_t::PACKED, self().data(), this->m_tail);
             }
 
-            return Number<VITS>(hash());
+            return record;
         }
 
 
-    protected:
+        // load() returns false and leaves the hasher untouched when the
+        // record was saved by another version, algorithm or width
 
+        bool
+        load(const void *record, const size_t &length)
+        {
+            const byte_t *memory = (const byte_t*)record;
+            uint64_t      volume = 0;
 
-        virtual void
-        compress()
+            if (length < HEADER + hasher_t::PACKED || memory[0] != VERSION || memory[1] != hasher_t::KIND)
+            {
+                return false;
+            }
+
+            if (memory[2] != byte_t(BITS) || memory[3] != byte_t(BITS >> 8) ||
+                memory[4] != byte_t(VITS) || memory[5] != byte_t(VITS >> 8))
+            {
+                return false;
+            }
+
+            for (size_t i = 0; i < 8; ++i)
+            {
+                volume |= uint64_t(memory[6 + i]) << (8 * i);
+            }
+
+            if (volume >= SIZE_MAX || length != HEADER + hasher_t::PACKED + volume % self().capacity())
+            {
+                return false;
+            }
+
+            self().unpack(memory + HEADER);
+            this->m_size = size_t(volume);
+            this->m_tail = size_t(volume % self().capacity());
+            memcpy(self().data(), memory + HEADER + hasher_t::PACKED, this->m_tail);
+            return true;
+        }
+
+
+        template<class char_t> bool
+        load(const String<char_t> &string)
         {
+            return load(string.data(), string.size() * sizeof(char_t));
         }
 
 
-        virtual void
-        finalize()
+    private:
+
+        enum : size_t
+        {
+            VERSION =  1,
+            HEADER  = 14,
+        };
+    };
+
+
+    // Virtual<hasher_t> wraps a hasher behind the type-erased interface,
+    // for callers that pick the algorithm at runtime
+
+    template<class hasher_t>
+    class Virtual : public hasher_t::erased_t
+    {
+        typedef typename hasher_t::erased_t erased_t;
+        typedef typename erased_t::byte_t   byte_t;
+
+        hasher_t        m_hasher;
+
+
+    public:
+
+        using erased_t::update;
+
+
+        template<class... args_t>
+        Virtual(args_t&&... args) : m_hasher(std::forward<args_t>(args)...)
+        {
+        }
+
+
+        const size_t&
+        size() const override
+        {
+            return this->m_hasher.size();
+        }
+
+
+        erased_t&
+        update(const void *record, const size_t &length) override
         {
+            return this->m_hasher.update(record, length), *this;
+        }
+
+
+        erased_t&
+        update(const size_t &length, const byte_t &record) override
+        {
+            return this->m_hasher.update(length, record), *this;
+        }
+
+
+        typename erased_t::digest_t
+        digest() override
+        {
+            return this->m_hasher.digest();
+        }
+
+
+        void
+        digest(void *record) override
+        {
+            this->m_hasher.digest(record);
+        }
+
+
+        erased_t&
+        reset() override
+        {
+            return this->m_hasher.reset(), *this;
+        }
+
+
+        String<>
+        save() const override
+        {
+            return this->m_hasher.save();
+        }
+
+
+        bool
+        load(const void *record, const size_t &length) override
+        {
+            return this->m_hasher.load(record, length);
         }
     };
 
@@ -227,24 +555,24 @@ namespace crypto
 
 
     uint32_t
-    inline rotl(const uint32_t &number, const int &length)
+    constexpr rotl(const uint32_t &number, const int &length)
     {
         #if defined(_WIN32)
-            return _lrotl(number, length);
-        #else
-            return (number << length) | (number >> (sizeof(number) * CHAR_BIT - length));
+            if (!compiling()) return _lrotl(number, length);
         #endif
+
+        return (number << length) | (number >> (sizeof(number) * CHAR_BIT - length));
     }
 
 
     uint64_t
-    inline rotl(const uint64_t &number, const int &length)
+    constexpr rotl(const uint64_t &number, const int &length)
     {
         #if defined(_WIN32)
-            return _rotl64(number, length);
-        #else
-            return (number << length) | (number >> (sizeof(number) * CHAR_BIT - length));
+            if (!compiling()) return _rotl64(number, length);
         #endif
+
+        return (number << length) | (number >> (sizeof(number) * CHAR_BIT - length));
     }
 
 
@@ -252,45 +580,45 @@ namespace crypto
 
 
     uint32_t
-    inline rotr(const uint32_t &number, const int &length)
+    constexpr rotr(const uint32_t &number, const int &length)
     {
         #if defined(_WIN32)
-            return _lrotr(number, length);
-        #else
-            return (number >> length) | (number << (sizeof(number) * CHAR_BIT - length));
+            if (!compiling()) return _lrotr(number, length);
         #endif
+
+        return (number >> length) | (number << (sizeof(number) * CHAR_BIT - length));
     }
 
 
     uint64_t
-    inline rotr(const uint64_t &number, const int &length)
+    constexpr rotr(const uint64_t &number, const int &length)
     {
         #if defined(_WIN32)
-            return _rotr64(number, length);
-        #else
-            return (number >> length) | (number << (sizeof(number) * CHAR_BIT - length));
+            if (!compiling()) return _rotr64(number, length);
         #endif
+
+        return (number >> length) | (number << (sizeof(number) * CHAR_BIT - length));
     }
 
 
     // boop()
 
 
-    template<typename uint_t> uint_t
+    template<typename uint_t> constexpr uint_t
     boop045(const uint_t &x, const uint_t &y, const uint_t &z) { return x ^ (y | ~z); }
 
-    template<typename uint_t> uint_t
+    template<typename uint_t> constexpr uint_t
     boop089(const uint_t &x, const uint_t &y, const uint_t &z) { return (x | ~y) ^ z; }
 
-    template<typename uint_t> uint_t
+    template<typename uint_t> constexpr uint_t
     boop150(const uint_t &x, const uint_t &y, const uint_t &z) { return x ^ y ^ z; }
 
-    template<typename uint_t> uint_t
+    template<typename uint_t> constexpr uint_t
     boop202(const uint_t &x, const uint_t &y, const uint_t &z) { return (x & (y ^ z)) ^ z; }
 
-    template<typename uint_t> uint_t
+    template<typename uint_t> constexpr uint_t
     boop228(const uint_t &x, const uint_t &y, const uint_t &z) { return (x & z) | (y & ~z); }
 
-    template<typename uint_t> uint_t
+    template<typename uint_t> constexpr uint_t
     boop232(const uint_t &x, const uint_t &y, const uint_t &z) { return (x & y) | ((x ^ y) & z); }
 }
@@ -0,0 +1,354 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Quasis (info@quasis.io)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+#include <array>
+#include "crypto/hasher.h"
+
+namespace crypto
+{
+    namespace hasher
+    {
+        // BLAKE2b<VITS> is BLAKE2b of RFC 7693 with a digest of VITS bits,
+        // unkeyed. The last block is compressed with a flag of its own, so
+        // update() always holds back the last whole block it has seen until
+        // the next block or finalize() shows whether more data follows.
+        // A digest length that is only known at run time, as Argon2 needs,
+        // is given to the constructor: the first length bytes of the digest
+        // are then valid and the rest are zero
+
+        template<size_t VITS = 512>
+        class BLAKE2b : public Hasher<512, VITS, BLAKE2b<VITS>>
+        {
+            friend class Hasher<512, VITS, BLAKE2b>;
+
+            typedef typename Hasher<512, VITS, BLAKE2b>::byte_t byte_t;
+            typedef uint64_t word_t;
+
+            static_assert(VITS % CHAR_BIT == 0 && VITS > 0 && VITS <= 512, "BLAKE2b digests are 1 to 64 bytes");
+
+            enum  : size_t
+            {
+                STATES =  8,
+                BLOCKS = 16,
+                ROUNDS = 12,
+                BLOCK  = BLOCKS * sizeof(word_t),
+                PACKED = STATES * sizeof(word_t) + sizeof(uint64_t) + 1 + BLOCK,
+                KIND   = 'B',
+            };
+
+            Number<STATES * 64, word_t>      m_hash;
+            uint64_t                         m_count;
+            size_t                           m_length;
+            bool                             m_held;
+            alignas(64)
+            Number<BLOCK * CHAR_BIT, byte_t> m_data;
+            alignas(64)
+            Number<BLOCK * CHAR_BIT, byte_t> m_last;
+
+
+        public:
+
+            static constexpr std::array<word_t, STATES> SEED =
+            {{
+                0x6A09E667F3BCC908, 0xBB67AE8584CAA73B, 0x3C6EF372FE94F82B, 0xA54FF53A5F1D36F1,
+                0x510E527FADE682D1, 0x9B05688C2B3E6C1F, 0x1F83D9ABFB41BD6B, 0x5BE0CD19137E2179,
+            }};
+
+            static constexpr uint8_t SIGMA[ROUNDS][BLOCKS] =
+            {
+                {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+                { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+                { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+                {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+                {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+                {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+                { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+                { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+                {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+                { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 },
+                {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+                { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+            };
+
+
+            explicit BLAKE2b(const size_t &length = VITS / CHAR_BIT) : m_length{ length }
+            {
+                assert(length > 0 && length <= VITS / CHAR_BIT);
+                this->initialize();
+            }
+
+
+           ~BLAKE2b()
+            {
+                this->m_count = 0;
+                memset(this->m_last.data(), 0, BLOCK);
+            }
+
+
+            const byte_t*
+            hash() const
+            {
+                return (byte_t*)(this->m_hash.data());
+            }
+
+
+            byte_t*
+            data()
+            {
+                return (byte_t*)(this->m_data.data());
+            }
+
+
+            const byte_t*
+            data() const
+            {
+                return (byte_t*)(this->m_data.data());
+            }
+
+
+            size_t
+            capacity() const
+            {
+                return BLOCK;
+            }
+
+
+            // transform() compresses one block; count is the number of
+            // message bytes up to the end of this block
+
+            static void
+            transform(word_t *hash, const byte_t *block, const uint64_t &count, const bool &last)
+            {
+                word_t words[BLOCKS], v[16];
+
+                memcpy(words, block, sizeof(words));
+
+                for (size_t i = 0; i < BLOCKS; ++i)
+                {
+                    words[i] = le2h(words[i]);
+                }
+
+                for (size_t i = 0; i < STATES; ++i)
+                {
+                    v[i] = hash[i]; v[i + 8] = SEED[i];
+                }
+
+                v[12] ^= count;
+                v[14] ^= last ? ~word_t(0) : word_t(0);
+
+                for (size_t r = 0; r < ROUNDS; ++r)
+                {
+                    const uint8_t *s = SIGMA[r];
+
+                    mix(v[0], v[4], v[ 8], v[12], words[s[ 0]], words[s[ 1]]);
+                    mix(v[1], v[5], v[ 9], v[13], words[s[ 2]], words[s[ 3]]);
+                    mix(v[2], v[6], v[10], v[14], words[s[ 4]], words[s[ 5]]);
+                    mix(v[3], v[7], v[11], v[15], words[s[ 6]], words[s[ 7]]);
+                    mix(v[0], v[5], v[10], v[15], words[s[ 8]], words[s[ 9]]);
+                    mix(v[1], v[6], v[11], v[12], words[s[10]], words[s[11]]);
+                    mix(v[2], v[7], v[ 8], v[13], words[s[12]], words[s[13]]);
+                    mix(v[3], v[4], v[ 9], v[14], words[s[14]], words[s[15]]);
+                }
+
+                for (size_t i = 0; i < STATES; ++i)
+                {
+                    hash[i] ^= v[i] ^ v[i + 8];
+                }
+            }
+
+
+            // oneshot() hashes a message into length bytes of output
+
+            static void
+            oneshot(const void *record, const size_t &length, void *output, const size_t &volume = VITS / CHAR_BIT)
+            {
+                BLAKE2b hasher(volume);
+                byte_t  digest[VITS / CHAR_BIT];
+
+                hasher.update(record, length).digest(digest);
+                memcpy(output, digest, volume);
+                memset(digest, 0, sizeof(digest));
+            }
+
+
+            static Number<VITS>
+            oneshot(const void *record, const size_t &length)
+            {
+                return BLAKE2b().update(record, length).digest();
+            }
+
+
+        protected:
+
+
+            static void
+            mix(word_t &a, word_t &b, word_t &c, word_t &d, const word_t &x, const word_t &y)
+            {
+                a = a + b + x; d = rotr(d ^ a, 32);
+                c = c + d;     b = rotr(b ^ c, 24);
+                a = a + b + y; d = rotr(d ^ a, 16);
+                c = c + d;     b = rotr(b ^ c, 63);
+            }
+
+
+            // compress() runs the held block and all given blocks but the
+            // last, which becomes the held one
+
+            void
+            compress(const byte_t *block, size_t count)
+            {
+                if (count == 0)
+                {
+                    return;
+                }
+
+                if (this->m_held)
+                {
+                    transform(this->m_hash.data(), this->m_last.data(), this->m_count += BLOCK, false);
+                }
+
+                for (; count > 1; --count, block += BLOCK)
+                {
+                    transform(this->m_hash.data(), block, this->m_count += BLOCK, false);
+                }
+
+                memcpy(this->m_last.data(), block, BLOCK);
+                this->m_held = true;
+            }
+
+
+            void
+            initialize()
+            {
+                memcpy(this->m_hash.data(), SEED.data(), sizeof(SEED));
+                this->m_hash[0] ^= 0x01010000 ^ word_t(this->m_length);
+                this->m_count = 0;
+                this->m_held  = false;
+            }
+
+
+            // pack() and unpack() move the chaining words, the byte count
+            // and the held block to and from the little-endian checkpoint
+
+            void
+            pack(byte_t *record) const
+            {
+                for (size_t i = 0; i < STATES; ++i)
+                {
+                    const word_t word = h2le(this->m_hash[i]);
+                    memcpy(record + i * sizeof(word_t), &word, sizeof(word_t));
+                }
+
+                for (size_t i = 0; i < sizeof(uint64_t); ++i)
+                {
+                    record[STATES * sizeof(word_t) + i] = byte_t(this->m_count >> (8 * i));
+                }
+
+                record[STATES * sizeof(word_t) + sizeof(uint64_t)] = byte_t(this->m_held);
+                memcpy(record + PACKED - BLOCK, this->m_last.data(), BLOCK);
+            }
+
+
+            void
+            unpack(const byte_t *record)
+            {
+                for (size_t i = 0; i < STATES; ++i)
+                {
+                    word_t word;
+                    memcpy(&word, record + i * sizeof(word_t), sizeof(word_t));
+                    this->m_hash[i] = le2h(word);
+                }
+
+                this->m_count = 0;
+
+                for (size_t i = 0; i < sizeof(uint64_t); ++i)
+                {
+                    this->m_count |= uint64_t(record[STATES * sizeof(word_t) + i]) << (8 * i);
+                }
+
+                this->m_held = record[STATES * sizeof(word_t) + sizeof(uint64_t)] != 0;
+                memcpy(this->m_last.data(), record + PACKED - BLOCK, BLOCK);
+            }
+
+
+            // finalize() flags the held block as the last one when no tail
+            // follows it, and otherwise the zero-padded tail
+
+            void
+            finalize()
+            {
+                byte_t *block = this->data();
+                size_t  tail  = size_t(this->end() - block);
+
+                if (this->m_held && tail == 0)
+                {
+                    transform(this->m_hash.data(), this->m_last.data(), this->m_count += BLOCK, true);
+                }
+                else
+                {
+                    if (this->m_held)
+                    {
+                        transform(this->m_hash.data(), this->m_last.data(), this->m_count += BLOCK, false);
+                    }
+
+                    memset(block + tail, 0, BLOCK - tail);
+                    transform(this->m_hash.data(), block, this->m_count += tail, true);
+                }
+
+                for (size_t i = 0; i < STATES; ++i)
+                {
+                    this->m_hash[i] = h2le(this->m_hash[i]);
+                }
+
+                memset((byte_t*)this->m_hash.data() + this->m_length, 0, sizeof(this->m_hash) - this->m_length);
+                memset(this->data(), 0, BLOCK);
+                memset(this->m_last.data(), 0, BLOCK);
+                this->m_held = false;
+            }
+        };
+    }
+
+
+    template<size_t VITS = 512> auto
+    blake2b(const void *record, const size_t &length)
+    {
+        return hasher::BLAKE2b<VITS>::oneshot(record, length);
+    }
+
+
+    template<size_t VITS = 512, class char_t> auto
+    blake2b(const String<char_t> &string)
+    {
+        return blake2b<VITS>(string.data(), string.size());
+    }
+
+
+    template<size_t VITS = 512> auto
+    blake2b(const char *string)
+    {
+        return blake2b<VITS>((void*)(string), strlen(string));
+    }
+}
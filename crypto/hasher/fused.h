@@ -0,0 +1,308 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Quasis (info@quasis.io)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+#include <algorithm>
+#include "crypto/hasher/sha.h"
+#include "crypto/hasher/rmd.h"
+
+namespace crypto
+{
+    namespace hasher
+    {
+        // padding of the last block for 32-byte and 64-byte messages: the
+        // 0x80 marker, zeros and the bit length, big-endian for SHA-256 and
+        // little-endian for RMD-160
+
+        constexpr uint8_t SHA256PAD32[32] =
+        {
+            0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00,
+        };
+
+        constexpr uint8_t SHA256PAD64[64] =
+        {
+            0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00,
+        };
+
+        constexpr uint8_t RMD160PAD32[32] =
+        {
+            0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        };
+
+
+        // sha256sched() returns the salted message schedule of SHA256PAD64,
+        // which only depends on constants and is expanded once
+
+        inline const uint32_t*
+        sha256sched()
+        {
+            static const auto table = []()
+            {
+                struct { uint32_t words[64]; } table{};
+                uint32_t *w = table.words;
+
+                memcpy(w, SHA256PAD64, sizeof(SHA256PAD64));
+
+                for (size_t i = 0; i < 16; ++i)
+                {
+                    w[i] = be2h(w[i]);
+                }
+
+                for (size_t i = 16; i < 64; ++i)
+                {
+                    w[i] = sigma1(w[i - 2]) + w[i - 7] + sigma0(w[i - 15]) + w[i - 16];
+                }
+
+                for (size_t i = 0; i < 64; ++i)
+                {
+                    w[i] += SHA<256>::SALT[i];
+                }
+
+                return table;
+            }();
+
+            return table.words;
+        }
+
+
+        // sha256inner() writes the SHA-256 digest of a record into the first
+        // 32 bytes of block, where the second pass expects it. 32-byte and
+        // 64-byte records skip the hasher and use the constant padding:
+        // without the SHA extensions the padding block of a 64-byte record
+        // only runs the rounds over its precomputed schedule. A block that
+        // carries a 32-byte message, as in every second pass, still goes
+        // through the kernel: half of its schedule depends on the message,
+        // and the SIMD schedules expand it faster than folding the constant
+        // words into a scalar one
+
+        void
+        inline sha256inner(uint8_t *block, const void *record, const size_t &length)
+        {
+            if (length != 32 && length != 64)
+            {
+                memcpy(block, sha<256>(record, length).data(), 32);
+                return;
+            }
+
+            uint32_t hash[8];
+            memcpy(hash, SHA<256>::SEED.data(), sizeof(hash));
+
+            if (length == 32)
+            {
+                memcpy(block, record, 32);
+                memcpy(block + 32, SHA256PAD32, 32);
+                SHA<256>::kernel()(hash, block, 1);
+            }
+            else
+            {
+                SHA<256>::kernel()(hash, (const uint8_t*)record, 1);
+
+                if (cpu().sha)
+                {
+                    SHA<256>::kernel()(hash, SHA256PAD64, 1);
+                }
+                else
+                {
+                    sha2rounds(hash, sha256sched(), 64);
+                }
+            }
+
+            for (size_t i = 0; i < 8; ++i)
+            {
+                hash[i] = h2be(hash[i]);
+            }
+
+            memcpy(block, hash, sizeof(hash));
+        }
+    }
+
+
+    // sha256d(), hash160()
+    //
+    // sha<256>(sha<256>(x)) and rmd<160>(sha<256>(x)) without intermediate
+    // hashers: the inner digest lands in a stack block that already holds
+    // the constant padding of a 32-byte message and is compressed once.
+
+
+    Number<256>
+    inline sha256d(const void *record, const size_t &length)
+    {
+        uint8_t  block[64];
+        uint32_t hash[8];
+
+        hasher::sha256inner(block, record, length);
+        memcpy(block + 32, hasher::SHA256PAD32, 32);
+        memcpy(hash, hasher::SHA<256>::SEED.data(), sizeof(hash));
+        hasher::SHA<256>::kernel()(hash, block, 1);
+
+        for (size_t i = 0; i < 8; ++i)
+        {
+            hash[i] = be2h(hash[i]);
+        }
+
+        memset(block, 0, sizeof(block));
+        return Number<256>((const uint8_t*)hash);
+    }
+
+
+    Number<160>
+    inline hash160(const void *record, const size_t &length)
+    {
+        uint8_t  block[64];
+        uint32_t hash[5];
+
+        hasher::sha256inner(block, record, length);
+        memcpy(block + 32, hasher::RMD160PAD32, 32);
+        memcpy(hash, hasher::RMD<160>::SEED.data(), sizeof(hash));
+        hasher::RMD<160>::transform(hash, block, 1);
+
+        for (size_t i = 0; i < 5; ++i)
+        {
+            hash[i] = le2h(hash[i]);
+        }
+
+        memset(block, 0, sizeof(block));
+        return Number<160>((const uint8_t*)hash);
+    }
+
+
+    // batches run both passes through the SIMD lanes, 64 messages at a time
+    // so the inner digests stay on the stack. With the SHA extensions the
+    // SHA-256 passes run one message at a time, which outruns the lanes:
+    // sha256d() takes the fused single-message path, while hash160() still
+    // batches the RMD-160 pass, which has no such instructions
+
+    void
+    inline sha256d(const Slice *slices, Number<256> *digests, const size_t &count)
+    {
+        if (cpu().sha)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                digests[i] = sha256d(slices[i].record, slices[i].length);
+            }
+
+            return;
+        }
+
+        Number<256> inner[64];
+        Slice       middle[64];
+
+        for (size_t i = 0, n; i < count; i += n)
+        {
+            n = std::min(count - i, size_t(64));
+            sha<256>(slices + i, inner, n);
+
+            for (size_t j = 0; j < n; ++j)
+            {
+                middle[j] = { inner[j].data(), inner[j].size() };
+            }
+
+            sha<256>(middle, digests + i, n);
+        }
+    }
+
+
+    void
+    inline hash160(const Slice *slices, Number<160> *digests, const size_t &count)
+    {
+        Number<256> inner[64];
+        Slice       middle[64];
+
+        for (size_t i = 0, n; i < count; i += n)
+        {
+            n = std::min(count - i, size_t(64));
+            sha<256>(slices + i, inner, n);
+
+            for (size_t j = 0; j < n; ++j)
+            {
+                middle[j] = { inner[j].data(), inner[j].size() };
+            }
+
+            rmd<160>(middle, digests + i, n);
+        }
+    }
+
+
+    template<size_t length> auto
+    sha256d(const Number<length> &number)
+    {
+        return sha256d(number.data(), number.size());
+    }
+
+
+    template<class char_t> auto
+    sha256d(const String<char_t> &string)
+    {
+        return sha256d(string.data(), string.size());
+    }
+
+
+    auto
+    inline sha256d(const char *string)
+    {
+        return sha256d((void*)(string), strlen(string));
+    }
+
+
+    template<class data_t> auto
+    sha256d(const data_t &object)
+    {
+        return sha256d((void*)&object, sizeof(data_t));
+    }
+
+
+    template<size_t length> auto
+    hash160(const Number<length> &number)
+    {
+        return hash160(number.data(), number.size());
+    }
+
+
+    template<class char_t> auto
+    hash160(const String<char_t> &string)
+    {
+        return hash160(string.data(), string.size());
+    }
+
+
+    auto
+    inline hash160(const char *string)
+    {
+        return hash160((void*)(string), strlen(string));
+    }
+
+
+    template<class data_t> auto
+    hash160(const data_t &object)
+    {
+        return hash160((void*)&object, sizeof(data_t));
+    }
+}
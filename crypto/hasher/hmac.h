@@ -0,0 +1,471 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Quasis (info@quasis.io)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+#include <mutex>
+#include <algorithm>
+#include <shared_mutex>
+#include <unordered_map>
+#include "crypto/hasher/sha.h"
+
+namespace crypto
+{
+    namespace hasher
+    {
+        // HMAC<BITS, VITS> authenticates messages with SHA<BITS, VITS> as in
+        // RFC 2104. A Key holds the chaining words after the ipad block and
+        // after the opad block, so the key blocks are compressed once per key
+        // and a message costs its own blocks plus one outer block
+
+        template<size_t BITS, size_t VITS = BITS>
+        class HMAC : public Hasher<BITS, VITS, HMAC<BITS, VITS>>
+        {
+            friend class Hasher<BITS, VITS, HMAC>;
+
+            typedef typename crypto::hasher::Option<BITS>     option;
+            typedef typename Hasher<BITS, VITS, HMAC>::byte_t byte_t;
+            typedef typename option::word_t                   word_t;
+            typedef typename option::long_t                   long_t;
+            typedef SHA<BITS, VITS>                           core_t;
+
+            static constexpr size_t _WORD_BIT = sizeof(word_t) * CHAR_BIT;
+            static constexpr size_t STATES   =            option::STATES;
+            static constexpr size_t BLOCKS   =            option::BLOCKS;
+            static constexpr size_t BLOCK    =  BLOCKS * sizeof(word_t);
+            static constexpr size_t PACKED   =  STATES * sizeof(word_t);
+            static constexpr size_t KIND     =                       'H';
+            static constexpr size_t DIGEST   =          VITS / CHAR_BIT;
+
+
+        public:
+
+            typedef Number<STATES * _WORD_BIT, word_t> state_t;
+
+
+            // Key is the schedule of one key: longer keys than a block are
+            // hashed first, shorter ones padded with zeros, and the ipad and
+            // opad blocks compressed from the seed
+
+            struct Key
+            {
+                state_t inner;
+                state_t outer;
+
+
+                Key()
+                {
+                }
+
+
+                Key(const void *record, const size_t &length)
+                {
+                    byte_t block[BLOCK] = {};
+
+                    if (length > BLOCK)
+                    {
+                        core_t().update(record, length).digest(block);
+                    }
+                    else if (length)
+                    {
+                        memcpy(block, record, length);
+                    }
+
+                    for (size_t i = 0; i < BLOCK; ++i)
+                    {
+                        block[i] ^= 0x36;
+                    }
+
+                    memcpy(this->inner.data(), core_t::SEED.data(), PACKED);
+                    core_t::kernel()(this->inner.data(), block, 1);
+
+                    for (size_t i = 0; i < BLOCK; ++i)
+                    {
+                        block[i] ^= 0x36 ^ 0x5C;
+                    }
+
+                    memcpy(this->outer.data(), core_t::SEED.data(), PACKED);
+                    core_t::kernel()(this->outer.data(), block, 1);
+
+                    memset(block, 0, sizeof(block));
+                }
+            };
+
+
+        private:
+
+            Key                                m_key;
+            state_t                            m_hash;
+            alignas(64)
+            Number<BLOCKS * _WORD_BIT, byte_t> m_data;
+
+
+        public:
+
+            explicit HMAC(const Key &key) : m_key{ key }, m_hash{ key.inner }, m_data{}
+            {
+            }
+
+
+            HMAC(const void *key, const size_t &length) : HMAC(Key(key, length))
+            {
+            }
+
+
+            const byte_t*
+            hash() const
+            {
+                return (byte_t*)(this->m_hash.data());
+            }
+
+
+            byte_t*
+            data()
+            {
+                return (byte_t*)(this->m_data.data());
+            }
+
+
+            const byte_t*
+            data() const
+            {
+                return (byte_t*)(this->m_data.data());
+            }
+
+
+            size_t
+            capacity() const
+            {
+                return (size_t)(this->m_data.size());
+            }
+
+
+            // oneshot() authenticates a message that fits one padded block
+            // on the stack: one inner and one outer compression in all
+
+            static Number<VITS>
+            oneshot(const Key &key, const void *record, const size_t &length)
+            {
+                if (length >= BLOCK - sizeof(long_t))
+                {
+                    return HMAC(key).update(record, length).digest();
+                }
+
+                state_t hash = key.inner;
+                byte_t  block[BLOCK];
+
+                memcpy(block, record, length);
+                block[length] = 0x80;
+                core_t::seal(block, length + 1, BLOCK + length);
+                core_t::kernel()(hash.data(), block, 1);
+
+                outer(key, hash, block);
+                memset(block, 0, sizeof(block));
+                return Number<VITS>((const byte_t*)hash.data());
+            }
+
+
+            // verify() compares tags in constant time
+
+            static bool
+            verify(const Key &key, const void *record, const size_t &length, const Number<VITS> &tag)
+            {
+                return equal(oneshot(key, record, length), tag);
+            }
+
+
+            // batch() authenticates count messages, message i under keys[i].
+            // Both passes run in the SIMD lanes where SHA<BITS, VITS>::batch()
+            // would use them, every lane starting from its own key schedule
+
+            template<class engine_t> static void
+            batch(const engine_t &engine, const Key *keys, const Slice *slices, Number<VITS> *digests, const size_t &count)
+            {
+                word_t       seeds[64 * STATES];
+                Number<VITS> inner[64];
+                Slice        middle[64];
+
+                for (size_t i = 0, n; i < count; i += n)
+                {
+                    n = std::min(count - i, size_t(64));
+
+                    for (size_t j = 0; j < n; ++j)
+                    {
+                        memcpy(seeds + j * STATES, keys[i + j].inner.data(), PACKED);
+                    }
+
+                    lanes(engine, seeds, slices + i, inner, n, STATES, BLOCK);
+
+                    for (size_t j = 0; j < n; ++j)
+                    {
+                        memcpy(seeds + j * STATES, keys[i + j].outer.data(), PACKED);
+                        middle[j] = { inner[j].data(), inner[j].size() };
+                    }
+
+                    lanes(engine, seeds, middle, digests + i, n, STATES, BLOCK);
+                }
+
+                memset(seeds, 0, sizeof(seeds));
+            }
+
+
+            static void
+            batch(const Key *keys, const Slice *slices, Number<VITS> *digests, const size_t &count)
+            {
+                #if defined(CRYPTO_X86)
+                    if constexpr (BITS == 256)
+                    {
+                        if (cpu().avx2 && !cpu().sha)
+                        {
+                            return batch(SHA256x8{core_t::SALT.data()}, keys, slices, digests, count);
+                        }
+                    }
+
+                    if constexpr (BITS == 512)
+                    {
+                        if (cpu().avx512)
+                        {
+                            return batch(SHA512x8{core_t::SALT.data()}, keys, slices, digests, count);
+                        }
+
+                        if (cpu().avx2)
+                        {
+                            return batch(SHA512x4{core_t::SALT.data()}, keys, slices, digests, count);
+                        }
+                    }
+                #endif
+
+                for (size_t i = 0; i < count; ++i)
+                {
+                    digests[i] = oneshot(keys[i], slices[i].record, slices[i].length);
+                }
+            }
+
+
+            // verify() of a batch sets valid[i] for every tag and returns the
+            // number of valid ones
+
+            static size_t
+            verify(const Key *keys, const Slice *slices, const Number<VITS> *tags, bool *valid, const size_t &count)
+            {
+                Number<VITS> digests[64];
+                size_t       total = 0;
+
+                for (size_t i = 0, n; i < count; i += n)
+                {
+                    n = std::min(count - i, size_t(64));
+                    batch(keys + i, slices + i, digests, n);
+
+                    for (size_t j = 0; j < n; ++j)
+                    {
+                        total += valid[i + j] = equal(digests[j], tags[i + j]);
+                    }
+                }
+
+                return total;
+            }
+
+
+        protected:
+
+            static bool
+            equal(const Number<VITS> &lvalue, const Number<VITS> &rvalue)
+            {
+                byte_t diff = 0;
+
+                for (size_t i = 0; i < DIGEST; ++i)
+                {
+                    diff |= lvalue[i] ^ rvalue[i];
+                }
+
+                return diff == 0;
+            }
+
+
+            // outer() turns the inner chaining words into the tag: the inner
+            // digest and its padding make up the single outer block
+
+            static void
+            outer(const Key &key, state_t &hash, byte_t *block)
+            {
+                for (size_t i = 0; i < STATES; ++i)
+                {
+                    hash[i] = h2be(hash[i]);
+                }
+
+                memcpy(block, hash.data(), DIGEST);
+                block[DIGEST] = 0x80;
+                core_t::seal(block, DIGEST + 1, BLOCK + DIGEST);
+
+                hash = key.outer;
+                core_t::kernel()(hash.data(), block, 1);
+
+                for (size_t i = 0; i < STATES; ++i)
+                {
+                    hash[i] = h2be(hash[i]);
+                }
+            }
+
+
+            void
+            compress(const byte_t *block, size_t count)
+            {
+                core_t::kernel()(this->m_hash.data(), block, count);
+            }
+
+
+            void
+            initialize()
+            {
+                this->m_hash = this->m_key.inner;
+            }
+
+
+            // checkpoints hold the inner chaining words only: load() them
+            // into an HMAC with the same key
+
+            void
+            pack(byte_t *record) const
+            {
+                for (size_t i = 0; i < STATES; ++i)
+                {
+                    const word_t word = h2le(this->m_hash[i]);
+                    memcpy(record + i * sizeof(word_t), &word, sizeof(word_t));
+                }
+            }
+
+
+            void
+            unpack(const byte_t *record)
+            {
+                for (size_t i = 0; i < STATES; ++i)
+                {
+                    word_t word;
+                    memcpy(&word, record + i * sizeof(word_t), sizeof(word_t));
+                    this->m_hash[i] = le2h(word);
+                }
+            }
+
+
+            void
+            finalize()
+            {
+                byte_t *block = this->data();
+                size_t  tail  = size_t(this->end() - block);
+
+                block[tail++] = 0x80;
+
+                if (tail > BLOCK - sizeof(long_t))
+                {
+                    memset(block + tail, 0, BLOCK - tail);
+                    this->compress(block, 1);
+                    tail = 0;
+                }
+
+                core_t::seal(block, tail, BLOCK + this->size());
+                this->compress(block, 1);
+
+                outer(this->m_key, this->m_hash, block);
+                memset(this->data(), 0, this->capacity());
+            }
+        };
+
+
+        // Keyring<BITS, VITS> keeps the schedules of long-lived keys by id,
+        // so each key is scheduled once for its lifetime. Lookups share a
+        // read lock and copy the schedule out, so a key can be replaced or
+        // erased while other threads still verify with it
+
+        template<size_t BITS, size_t VITS = BITS>
+        class Keyring
+        {
+            typedef typename HMAC<BITS, VITS>::Key key_t;
+
+            std::unordered_map<String<>, key_t> m_keys;
+            mutable std::shared_mutex           m_mutex;
+
+
+        public:
+
+            size_t
+            size() const
+            {
+                std::shared_lock<std::shared_mutex> lock(this->m_mutex);
+                return this->m_keys.size();
+            }
+
+
+            void
+            insert(const String<> &id, const void *key, const size_t &length)
+            {
+                const key_t schedule(key, length);
+
+                std::unique_lock<std::shared_mutex> lock(this->m_mutex);
+                this->m_keys[id] = schedule;
+            }
+
+
+            bool
+            erase(const String<> &id)
+            {
+                std::unique_lock<std::shared_mutex> lock(this->m_mutex);
+                return this->m_keys.erase(id) > 0;
+            }
+
+
+            bool
+            find(const String<> &id, key_t &key) const
+            {
+                std::shared_lock<std::shared_mutex> lock(this->m_mutex);
+                const auto found = this->m_keys.find(id);
+
+                return found != this->m_keys.end() ? (key = found->second, true) : false;
+            }
+
+
+            // verify() fails for unknown ids as for wrong tags
+
+            bool
+            verify(const String<> &id, const void *record, const size_t &length, const Number<VITS> &tag) const
+            {
+                key_t key;
+                return this->find(id, key) && HMAC<BITS, VITS>::verify(key, record, length, tag);
+            }
+        };
+    }
+
+
+    template<size_t BITS, size_t VITS = BITS> auto
+    hmac(const typename hasher::HMAC<BITS, VITS>::Key &key, const void *record, const size_t &length)
+    {
+        return hasher::HMAC<BITS, VITS>::oneshot(key, record, length);
+    }
+
+
+    template<size_t BITS, size_t VITS = BITS> auto
+    hmac(const void *key, const size_t &size, const void *record, const size_t &length)
+    {
+        return hasher::HMAC<BITS, VITS>::oneshot(typename hasher::HMAC<BITS, VITS>::Key(key, size), record, length);
+    }
+}
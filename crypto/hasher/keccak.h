@@ -0,0 +1,553 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Quasis (info@quasis.io)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+#include <array>
+#include "crypto/hasher.h"
+#include "crypto/hasher/keccak/avx2.h"
+
+namespace crypto
+{
+    namespace hasher
+    {
+        // Keccak1600
+        //
+        // The scalar Keccak-f[1600] permutation. permute() runs in the
+        // lane-complementing representation: six lanes are kept inverted
+        // between rounds, which turns all but one NOT per row of chi into
+        // the AND/OR pattern below. The lanes are inverted on the way in and
+        // out, so callers see the plain state. absorb() is the one-lane
+        // engine of Keccak::batch().
+
+
+        struct Keccak1600
+        {
+            static constexpr size_t LANES  = 1;
+            static constexpr size_t STATES = 25;
+            static constexpr size_t ROUNDS = 24;
+
+            typedef uint64_t word_t;
+
+            static constexpr std::array<word_t, ROUNDS> SALT =
+            {{
+                0x0000000000000001, 0x0000000000008082, 0x800000000000808A, 0x8000000080008000,
+                0x000000000000808B, 0x0000000080000001, 0x8000000080008081, 0x8000000000008009,
+                0x000000000000008A, 0x0000000000000088, 0x0000000080008009, 0x000000008000000A,
+                0x000000008000808B, 0x800000000000008B, 0x8000000000008089, 0x8000000000008003,
+                0x8000000000008002, 0x8000000000000080, 0x000000000000800A, 0x800000008000000A,
+                0x8000000080008081, 0x8000000000008080, 0x0000000080000001, 0x8000000080008008,
+            }};
+
+            size_t          words;
+
+
+            void
+            absorb(word_t *state, const uint8_t *const *block) const
+            {
+                for (size_t i = 0; i < this->words; ++i)
+                {
+                    word_t word;
+                    memcpy(&word, block[0] + i * sizeof(word_t), sizeof(word_t));
+                    state[i] ^= le2h(word);
+                }
+
+                permute(state);
+            }
+
+
+            static void
+            permute(word_t *state)
+            {
+                word_t a[25], b[25];
+
+                memcpy(a, state, sizeof(a));
+                a[1] = ~a[1]; a[2] = ~a[2]; a[8] = ~a[8]; a[12] = ~a[12]; a[17] = ~a[17]; a[20] = ~a[20];
+
+                for (size_t r = 0; r < ROUNDS; ++r)
+                {
+                    const word_t c0 = a[0] ^ a[5] ^ a[10] ^ a[15] ^ a[20];
+                    const word_t c1 = a[1] ^ a[6] ^ a[11] ^ a[16] ^ a[21];
+                    const word_t c2 = a[2] ^ a[7] ^ a[12] ^ a[17] ^ a[22];
+                    const word_t c3 = a[3] ^ a[8] ^ a[13] ^ a[18] ^ a[23];
+                    const word_t c4 = a[4] ^ a[9] ^ a[14] ^ a[19] ^ a[24];
+
+                    const word_t d0 = c4 ^ rotl(c1, 1);
+                    const word_t d1 = c0 ^ rotl(c2, 1);
+                    const word_t d2 = c1 ^ rotl(c3, 1);
+                    const word_t d3 = c2 ^ rotl(c4, 1);
+                    const word_t d4 = c3 ^ rotl(c0, 1);
+
+                    // theta, rho and pi: lane (x, y) moves to (y, 2x + 3y)
+
+                    b[ 0] =      a[ 0] ^ d0;
+                    b[ 1] = rotl(a[ 6] ^ d1, 44);
+                    b[ 2] = rotl(a[12] ^ d2, 43);
+                    b[ 3] = rotl(a[18] ^ d3, 21);
+                    b[ 4] = rotl(a[24] ^ d4, 14);
+                    b[ 5] = rotl(a[ 3] ^ d3, 28);
+                    b[ 6] = rotl(a[ 9] ^ d4, 20);
+                    b[ 7] = rotl(a[10] ^ d0,  3);
+                    b[ 8] = rotl(a[16] ^ d1, 45);
+                    b[ 9] = rotl(a[22] ^ d2, 61);
+                    b[10] = rotl(a[ 1] ^ d1,  1);
+                    b[11] = rotl(a[ 7] ^ d2,  6);
+                    b[12] = rotl(a[13] ^ d3, 25);
+                    b[13] = rotl(a[19] ^ d4,  8);
+                    b[14] = rotl(a[20] ^ d0, 18);
+                    b[15] = rotl(a[ 4] ^ d4, 27);
+                    b[16] = rotl(a[ 5] ^ d0, 36);
+                    b[17] = rotl(a[11] ^ d1, 10);
+                    b[18] = rotl(a[17] ^ d2, 15);
+                    b[19] = rotl(a[23] ^ d3, 56);
+                    b[20] = rotl(a[ 2] ^ d2, 62);
+                    b[21] = rotl(a[ 8] ^ d3, 55);
+                    b[22] = rotl(a[14] ^ d4, 39);
+                    b[23] = rotl(a[15] ^ d0, 41);
+                    b[24] = rotl(a[21] ^ d1,  2);
+
+                    // chi and iota over complemented lanes
+
+                    a[ 0] =  b[ 0] ^ ( b[ 1] |  b[ 2]) ^ SALT[r];
+                    a[ 1] =  b[ 1] ^ (~b[ 2] |  b[ 3]);
+                    a[ 2] =  b[ 2] ^ ( b[ 3] &  b[ 4]);
+                    a[ 3] =  b[ 3] ^ ( b[ 4] |  b[ 0]);
+                    a[ 4] =  b[ 4] ^ ( b[ 0] &  b[ 1]);
+
+                    a[ 5] =  b[ 5] ^ ( b[ 6] |  b[ 7]);
+                    a[ 6] =  b[ 6] ^ ( b[ 7] &  b[ 8]);
+                    a[ 7] =  b[ 7] ^ ( b[ 8] | ~b[ 9]);
+                    a[ 8] =  b[ 8] ^ ( b[ 9] |  b[ 5]);
+                    a[ 9] =  b[ 9] ^ ( b[ 5] &  b[ 6]);
+
+                    a[10] =  b[10] ^ ( b[11] |  b[12]);
+                    a[11] =  b[11] ^ ( b[12] &  b[13]);
+                    a[12] =  b[12] ^ (~b[13] &  b[14]);
+                    a[13] = ~b[13] ^ ( b[14] |  b[10]);
+                    a[14] =  b[14] ^ ( b[10] &  b[11]);
+
+                    a[15] =  b[15] ^ ( b[16] &  b[17]);
+                    a[16] =  b[16] ^ ( b[17] |  b[18]);
+                    a[17] =  b[17] ^ (~b[18] |  b[19]);
+                    a[18] = ~b[18] ^ ( b[19] &  b[15]);
+                    a[19] =  b[19] ^ ( b[15] |  b[16]);
+
+                    a[20] =  b[20] ^ (~b[21] &  b[22]);
+                    a[21] = ~b[21] ^ ( b[22] |  b[23]);
+                    a[22] =  b[22] ^ ( b[23] &  b[24]);
+                    a[23] =  b[23] ^ ( b[24] |  b[20]);
+                    a[24] =  b[24] ^ ( b[20] &  b[21]);
+                }
+
+                a[1] = ~a[1]; a[2] = ~a[2]; a[8] = ~a[8]; a[12] = ~a[12]; a[17] = ~a[17]; a[20] = ~a[20];
+                memcpy(state, a, sizeof(a));
+            }
+        };
+
+
+        // Keccak<BITS, VITS, PAD> is the sponge over Keccak-f[1600] with a
+        // capacity of 2 * BITS bits and VITS bits of digest. PAD holds the
+        // domain bits and the first bit of the padding: 0x01 for the
+        // original Keccak of Ethereum, 0x06 for SHA3 and 0x1F for SHAKE.
+        // After finalize() the data buffer holds the first output block,
+        // which hash() returns; squeeze() of SHAKE reads the output stream
+        // straight from the state
+
+        template<size_t BITS, size_t VITS = BITS, uint8_t PAD = 0x01>
+        class Keccak : public Hasher<BITS, VITS, Keccak<BITS, VITS, PAD>>
+        {
+            friend class Hasher<BITS, VITS, Keccak>;
+
+            typedef typename Hasher<BITS, VITS, Keccak>::byte_t byte_t;
+            typedef Keccak1600::word_t                          word_t;
+
+            static constexpr size_t STATES = Keccak1600::STATES;
+            static constexpr size_t RATE   = 200 - BITS / 4;
+            static constexpr size_t WORDS  = RATE / sizeof(word_t);
+            static constexpr size_t PACKED = STATES * sizeof(word_t);
+            static constexpr size_t KIND   = PAD == 0x06 ? '3' : PAD == 0x1F ? 'X' : 'K';
+
+            static_assert(BITS % 32 == 0 && BITS >= 128 && BITS <= 512, "capacities from 256 to 1024 bits");
+            static_assert(VITS % CHAR_BIT == 0 && VITS <= RATE * CHAR_BIT, "digests up to one block");
+
+            Number<STATES * 64, word_t>     m_state;
+            size_t                          m_offset;
+            alignas(64)
+            Number<RATE * CHAR_BIT, byte_t> m_data;
+
+
+        public:
+
+            static constexpr auto &SALT = Keccak1600::SALT;
+
+
+            Keccak() : m_state{}, m_offset{ 0 }, m_data{}
+            {
+            }
+
+
+           ~Keccak()
+            {
+            }
+
+
+            const byte_t*
+            hash() const
+            {
+                return (byte_t*)(this->m_data.data());
+            }
+
+
+            byte_t*
+            data()
+            {
+                return (byte_t*)(this->m_data.data());
+            }
+
+
+            const byte_t*
+            data() const
+            {
+                return (byte_t*)(this->m_data.data());
+            }
+
+
+            size_t
+            capacity() const
+            {
+                return RATE;
+            }
+
+
+            // squeeze() appends volume bytes of the output stream of SHAKE,
+            // finalizing the hasher on the first call. Consecutive calls
+            // continue the stream, and digest() still returns its start
+
+            Keccak&
+            squeeze(void *output, const size_t &volume)
+            {
+                static_assert(PAD == 0x1F, "only SHAKE squeezes");
+
+                byte_t *memory = (byte_t*)output;
+
+                this->close();
+
+                for (size_t i = 0; i < volume; ++i, ++this->m_offset)
+                {
+                    if (this->m_offset == RATE)
+                    {
+                        Keccak1600::permute(this->m_state.data());
+                        this->m_offset = 0;
+                    }
+
+                    memory[i] = byte_t(this->m_state[this->m_offset / sizeof(word_t)] >> (this->m_offset % sizeof(word_t) * CHAR_BIT));
+                }
+
+                return *this;
+            }
+
+
+            static Number<VITS>
+            oneshot(const void *record, const size_t &length)
+            {
+                return Keccak().update(record, length).digest();
+            }
+
+
+            // batch() hashes independent messages four at a time in the
+            // lanes of Keccak1600x4, or one by one without AVX2
+
+            static void
+            batch(const Slice *slices, Number<VITS> *digests, const size_t &count)
+            {
+                #if defined(CRYPTO_X86)
+                    if (cpu().avx2)
+                    {
+                        return batch(Keccak1600x4{SALT.data(), WORDS}, slices, digests, count);
+                    }
+                #endif
+
+                batch(Keccak1600{WORDS}, slices, digests, count);
+            }
+
+
+            // batch() over an engine runs a message per lane, as lanes() does
+            // for the Merkle-Damgard hashers: a lane that absorbs its padded
+            // last block writes its digest and takes the next message, and
+            // idle lanes absorb zeros that are discarded
+
+            template<class engine_t> static void
+            batch(const engine_t &engine, const Slice *slices, Number<VITS> *digests, const size_t &count)
+            {
+                constexpr size_t LANES = engine_t::LANES;
+
+                struct Lane
+                {
+                    const byte_t   *record;
+                    size_t          blocks;
+                    size_t          offset;
+                    bool            active;
+                    bool            padded;
+                    byte_t          buffer[RATE];
+                };
+
+                Lane            lane[LANES]{};
+                word_t          state[STATES * LANES];
+                const byte_t   *block[LANES];
+                const byte_t    dummy[RATE]{};
+                size_t          next = 0, busy = 0;
+
+                auto assign = [&](const size_t &l)
+                {
+                    if (next == count)
+                    {
+                        lane[l].active = false;
+                        return;
+                    }
+
+                    const size_t length = slices[next].length;
+                    const size_t remain = length % RATE;
+
+                    lane[l].record = (const byte_t*)slices[next].record;
+                    lane[l].blocks = length / RATE;
+                    lane[l].offset = next++;
+                    lane[l].active = true;
+                    lane[l].padded = false;
+
+                    memcpy(lane[l].buffer, lane[l].record + length - remain, remain);
+                    memset(lane[l].buffer + remain, 0, RATE - remain);
+                    lane[l].buffer[remain]   ^= PAD;
+                    lane[l].buffer[RATE - 1] ^= 0x80;
+
+                    for (size_t i = 0; i < STATES; ++i)
+                    {
+                        state[i * LANES + l] = 0;
+                    }
+
+                    ++busy;
+                };
+
+                auto output = [&](const size_t &l)
+                {
+                    byte_t result[VITS / CHAR_BIT];
+
+                    for (size_t i = 0; i < sizeof(result); ++i)
+                    {
+                        result[i] = byte_t(state[i / sizeof(word_t) * LANES + l] >> (i % sizeof(word_t) * CHAR_BIT));
+                    }
+
+                    digests[lane[l].offset] = Number<VITS>(result);
+                    --busy;
+                };
+
+                for (size_t l = 0; l < LANES; ++l)
+                {
+                    assign(l);
+                }
+
+                while (busy)
+                {
+                    for (size_t l = 0; l < LANES; ++l)
+                    {
+                        if (!lane[l].active)
+                        {
+                            block[l] = dummy;
+                        }
+                        else if (lane[l].blocks)
+                        {
+                            block[l] = lane[l].record;
+                            lane[l].record += RATE;
+                            lane[l].blocks -= 1;
+                        }
+                        else
+                        {
+                            block[l] = lane[l].buffer;
+                            lane[l].padded = true;
+                        }
+                    }
+
+                    engine.absorb(state, block);
+
+                    for (size_t l = 0; l < LANES; ++l)
+                    {
+                        if (lane[l].active && lane[l].padded)
+                        {
+                            output(l);
+                            assign(l);
+                        }
+                    }
+                }
+
+                memset(lane, 0, sizeof(lane));
+                memset(state, 0, sizeof(state));
+            }
+
+
+        protected:
+
+
+            void
+            compress(const byte_t *block, size_t count)
+            {
+                const Keccak1600 engine{WORDS};
+
+                for (; count; --count, block += RATE)
+                {
+                    engine.absorb(this->m_state.data(), &block);
+                }
+            }
+
+
+            void
+            initialize()
+            {
+                memset(this->m_state.data(), 0, sizeof(this->m_state));
+                this->m_offset = 0;
+            }
+
+
+            // pack() and unpack() move the 25 lanes to and from the
+            // little-endian form used by checkpoints
+
+            void
+            pack(byte_t *record) const
+            {
+                for (size_t i = 0; i < STATES; ++i)
+                {
+                    const word_t word = h2le(this->m_state[i]);
+                    memcpy(record + i * sizeof(word_t), &word, sizeof(word_t));
+                }
+            }
+
+
+            void
+            unpack(const byte_t *record)
+            {
+                for (size_t i = 0; i < STATES; ++i)
+                {
+                    word_t word;
+                    memcpy(&word, record + i * sizeof(word_t), sizeof(word_t));
+                    this->m_state[i] = le2h(word);
+                }
+            }
+
+
+            // finalize() pads the tail, absorbs it and leaves the first
+            // block of output in the data buffer
+
+            void
+            finalize()
+            {
+                byte_t *block = this->data();
+                size_t  tail  = size_t(this->end() - block);
+
+                memset(block + tail, 0, RATE - tail);
+                block[tail]     ^= PAD;
+                block[RATE - 1] ^= 0x80;
+
+                this->compress(block, 1);
+
+                for (size_t i = 0; i < RATE; ++i)
+                {
+                    block[i] = byte_t(this->m_state[i / sizeof(word_t)] >> (i % sizeof(word_t) * CHAR_BIT));
+                }
+
+                this->m_offset = 0;
+            }
+        };
+
+
+        template<size_t BITS>
+        using SHA3 = Keccak<BITS, BITS, 0x06>;
+
+
+        template<size_t BITS, size_t VITS = 2 * BITS>
+        using SHAKE = Keccak<BITS, VITS, 0x1F>;
+    }
+
+
+    template<size_t BITS> auto
+    keccak(const void *record, const size_t &length)
+    {
+        return hasher::Keccak<BITS>::oneshot(record, length);
+    }
+
+
+    template<size_t BITS> void
+    keccak(const Slice *slices, Number<BITS> *digests, const size_t &count)
+    {
+        hasher::Keccak<BITS>::batch(slices, digests, count);
+    }
+
+
+    template<size_t BITS, class char_t> auto
+    keccak(const String<char_t> &string)
+    {
+        return keccak<BITS>(string.data(), string.size());
+    }
+
+
+    template<size_t BITS> auto
+    keccak(const char *string)
+    {
+        return keccak<BITS>((void*)(string), strlen(string));
+    }
+
+
+    template<size_t BITS> auto
+    sha3(const void *record, const size_t &length)
+    {
+        return hasher::SHA3<BITS>::oneshot(record, length);
+    }
+
+
+    template<size_t BITS> void
+    sha3(const Slice *slices, Number<BITS> *digests, const size_t &count)
+    {
+        hasher::SHA3<BITS>::batch(slices, digests, count);
+    }
+
+
+    template<size_t BITS, class char_t> auto
+    sha3(const String<char_t> &string)
+    {
+        return sha3<BITS>(string.data(), string.size());
+    }
+
+
+    template<size_t BITS> auto
+    sha3(const char *string)
+    {
+        return sha3<BITS>((void*)(string), strlen(string));
+    }
+
+
+    // shake() writes volume bytes of SHAKE128 or SHAKE256 output
+
+    template<size_t BITS> void
+    shake(const void *record, const size_t &length, void *output, const size_t &volume)
+    {
+        hasher::SHAKE<BITS>().update(record, length).squeeze(output, volume);
+    }
+}
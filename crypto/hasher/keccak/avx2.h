@@ -0,0 +1,195 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Quasis (info@quasis.io)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+#include "crypto/cpu.h"
+
+#if defined(CRYPTO_X86)
+
+namespace crypto
+{
+    namespace hasher
+    {
+        // Keccak1600x4
+        //
+        // Four Keccak-f[1600] permutations side by side, one state per 64-bit
+        // lane of an AVX2 register. The state is word-major: state[4 * i + l]
+        // is lane i of state l. absorb() xors the first words of a block of
+        // every state in, transposed four words at a time with unpack and
+        // permute, and runs the permutation. Chi uses andnot, so the lanes
+        // are not complemented as in the scalar permutation; rotations by 8
+        // and 56 are byte shuffles.
+
+
+        struct Keccak1600x4
+        {
+            static constexpr size_t LANES  = 4;
+            static constexpr size_t STATES = 25;
+
+            typedef uint64_t word_t;
+
+            const uint64_t *salt;
+            size_t          words;
+
+
+            CRYPTO_TARGET("avx2") void
+            absorb(uint64_t *state, const uint8_t *const *block) const
+            {
+                __m256i a[25];
+                size_t  i = 0;
+
+                for (size_t k = 0; k < 25; ++k)
+                {
+                    a[k] = _mm256_loadu_si256((const __m256i*)(state + 4 * k));
+                }
+
+                for (; i + 4 <= this->words; i += 4)
+                {
+                    __m256i r[4], t[4];
+
+                    for (size_t l = 0; l < 4; ++l)
+                    {
+                        r[l] = _mm256_loadu_si256((const __m256i*)(block[l] + 8 * i));
+                    }
+
+                    t[0] = _mm256_unpacklo_epi64(r[0], r[1]);
+                    t[1] = _mm256_unpackhi_epi64(r[0], r[1]);
+                    t[2] = _mm256_unpacklo_epi64(r[2], r[3]);
+                    t[3] = _mm256_unpackhi_epi64(r[2], r[3]);
+
+                    a[i + 0] = _mm256_xor_si256(a[i + 0], _mm256_permute2x128_si256(t[0], t[2], 0x20));
+                    a[i + 1] = _mm256_xor_si256(a[i + 1], _mm256_permute2x128_si256(t[1], t[3], 0x20));
+                    a[i + 2] = _mm256_xor_si256(a[i + 2], _mm256_permute2x128_si256(t[0], t[2], 0x31));
+                    a[i + 3] = _mm256_xor_si256(a[i + 3], _mm256_permute2x128_si256(t[1], t[3], 0x31));
+                }
+
+                for (; i < this->words; ++i)
+                {
+                    uint64_t w[4];
+
+                    for (size_t l = 0; l < 4; ++l)
+                    {
+                        memcpy(&w[l], block[l] + 8 * i, 8);
+                    }
+
+                    a[i] = _mm256_xor_si256(a[i], _mm256_loadu_si256((const __m256i*)w));
+                }
+
+                permute(a, this->salt);
+
+                for (size_t k = 0; k < 25; ++k)
+                {
+                    _mm256_storeu_si256((__m256i*)(state + 4 * k), a[k]);
+                }
+            }
+
+
+            template<int N> CRYPTO_TARGET("avx2") static __m256i
+            rotl(const __m256i &x)
+            {
+                if constexpr (N == 8)
+                {
+                    return _mm256_shuffle_epi8(x, _mm256_setr_epi8(7, 0, 1, 2, 3, 4, 5, 6, 15, 8, 9, 10, 11, 12, 13, 14, 7, 0, 1, 2, 3, 4, 5, 6, 15, 8, 9, 10, 11, 12, 13, 14));
+                }
+                else if constexpr (N == 56)
+                {
+                    return _mm256_shuffle_epi8(x, _mm256_setr_epi8(1, 2, 3, 4, 5, 6, 7, 0, 9, 10, 11, 12, 13, 14, 15, 8, 1, 2, 3, 4, 5, 6, 7, 0, 9, 10, 11, 12, 13, 14, 15, 8));
+                }
+                else
+                {
+                    return _mm256_or_si256(_mm256_slli_epi64(x, N), _mm256_srli_epi64(x, 64 - N));
+                }
+            }
+
+
+            // chi() computes one row of five lanes from b
+
+            CRYPTO_TARGET("avx2") static void
+            chi(__m256i *a, const __m256i *b)
+            {
+                a[0] = _mm256_xor_si256(b[0], _mm256_andnot_si256(b[1], b[2]));
+                a[1] = _mm256_xor_si256(b[1], _mm256_andnot_si256(b[2], b[3]));
+                a[2] = _mm256_xor_si256(b[2], _mm256_andnot_si256(b[3], b[4]));
+                a[3] = _mm256_xor_si256(b[3], _mm256_andnot_si256(b[4], b[0]));
+                a[4] = _mm256_xor_si256(b[4], _mm256_andnot_si256(b[0], b[1]));
+            }
+
+
+            CRYPTO_TARGET("avx2") static void
+            permute(__m256i *a, const uint64_t *salt)
+            {
+                for (size_t r = 0; r < 24; ++r)
+                {
+                    __m256i c[5], d[5], b[25];
+
+                    for (size_t x = 0; x < 5; ++x)
+                    {
+                        c[x] = _mm256_xor_si256(_mm256_xor_si256(a[x], a[x + 5]), _mm256_xor_si256(_mm256_xor_si256(a[x + 10], a[x + 15]), a[x + 20]));
+                    }
+
+                    for (size_t x = 0; x < 5; ++x)
+                    {
+                        d[x] = _mm256_xor_si256(c[(x + 4) % 5], rotl<1>(c[(x + 1) % 5]));
+                    }
+
+                    b[ 0] =           _mm256_xor_si256(a[ 0], d[0]);
+                    b[ 1] = rotl<44>(_mm256_xor_si256(a[ 6], d[1]));
+                    b[ 2] = rotl<43>(_mm256_xor_si256(a[12], d[2]));
+                    b[ 3] = rotl<21>(_mm256_xor_si256(a[18], d[3]));
+                    b[ 4] = rotl<14>(_mm256_xor_si256(a[24], d[4]));
+                    b[ 5] = rotl<28>(_mm256_xor_si256(a[ 3], d[3]));
+                    b[ 6] = rotl<20>(_mm256_xor_si256(a[ 9], d[4]));
+                    b[ 7] = rotl< 3>(_mm256_xor_si256(a[10], d[0]));
+                    b[ 8] = rotl<45>(_mm256_xor_si256(a[16], d[1]));
+                    b[ 9] = rotl<61>(_mm256_xor_si256(a[22], d[2]));
+                    b[10] = rotl< 1>(_mm256_xor_si256(a[ 1], d[1]));
+                    b[11] = rotl< 6>(_mm256_xor_si256(a[ 7], d[2]));
+                    b[12] = rotl<25>(_mm256_xor_si256(a[13], d[3]));
+                    b[13] = rotl< 8>(_mm256_xor_si256(a[19], d[4]));
+                    b[14] = rotl<18>(_mm256_xor_si256(a[20], d[0]));
+                    b[15] = rotl<27>(_mm256_xor_si256(a[ 4], d[4]));
+                    b[16] = rotl<36>(_mm256_xor_si256(a[ 5], d[0]));
+                    b[17] = rotl<10>(_mm256_xor_si256(a[11], d[1]));
+                    b[18] = rotl<15>(_mm256_xor_si256(a[17], d[2]));
+                    b[19] = rotl<56>(_mm256_xor_si256(a[23], d[3]));
+                    b[20] = rotl<62>(_mm256_xor_si256(a[ 2], d[2]));
+                    b[21] = rotl<55>(_mm256_xor_si256(a[ 8], d[3]));
+                    b[22] = rotl<39>(_mm256_xor_si256(a[14], d[4]));
+                    b[23] = rotl<41>(_mm256_xor_si256(a[15], d[0]));
+                    b[24] = rotl< 2>(_mm256_xor_si256(a[21], d[1]));
+
+                    for (size_t y = 0; y < 25; y += 5)
+                    {
+                        chi(a + y, b + y);
+                    }
+
+                    a[0] = _mm256_xor_si256(a[0], _mm256_set1_epi64x((long long)salt[r]));
+                }
+            }
+        };
+    }
+}
+
+#endif
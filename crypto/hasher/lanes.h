@@ -0,0 +1,180 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Quasis (info@quasis.io)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+#include "crypto/hasher.h"
+
+namespace crypto
+{
+    namespace hasher
+    {
+        // lanes()
+        //
+        // Drives a multi-buffer engine over a batch of independent messages.
+        // Every lane runs its own message; when a lane consumes its last
+        // padded block the digest is written out and the next message of the
+        // batch is loaded into that lane. Once the batch runs dry the idle
+        // lanes are masked: they are fed a dummy block and their state is
+        // discarded. The engine supplies the word type, the number of LANES
+        // and STATES, the byte order of the padding and a compress() that
+        // runs one block on every lane of a word-major state.
+        //
+        // Every message starts from the same seed unless stride is set, in
+        // which case message n starts from the STATES words at seed + n *
+        // stride. A prefix counts bytes already absorbed into those words,
+        // such as the ipad block of HMAC, in the length of every message.
+
+
+        template<class engine_t, size_t VITS> void
+        lanes(const engine_t &engine, const typename engine_t::word_t *seed,
+              const Slice *slices, Number<VITS> *digests, const size_t &count,
+              const size_t &stride = 0, const size_t &prefix = 0)
+        {
+            typedef typename engine_t::word_t word_t;
+            typedef uint8_t                   byte_t;
+
+            constexpr size_t LANES  = engine_t::LANES;
+            constexpr size_t STATES = engine_t::STATES;
+            constexpr size_t BLOCK  = 16 * sizeof(word_t);
+            constexpr size_t LENGTH =  2 * sizeof(word_t);
+
+            struct Lane
+            {
+                const byte_t   *record;
+                const byte_t   *finish;
+                size_t          blocks;
+                size_t          finals;
+                size_t          offset;
+                bool            active;
+                byte_t          buffer[2 * BLOCK];
+            };
+
+            Lane            lane[LANES]{};
+            word_t          state[STATES * LANES];
+            const byte_t   *block[LANES];
+            const byte_t    dummy[BLOCK]{};
+            size_t          next = 0, busy = 0;
+
+            auto assign = [&](const size_t &l)
+            {
+                if (next == count)
+                {
+                    lane[l].active = false;
+                    return;
+                }
+
+                const size_t length = slices[next].length;
+                const size_t remain = length % BLOCK;
+                const uint64_t lower = uint64_t(prefix + length) << 3;
+                const uint64_t upper = uint64_t(prefix + length) >> 61;
+                const word_t  *start = seed + next * stride;
+
+                lane[l].record = (const byte_t*)slices[next].record;
+                lane[l].blocks = length / BLOCK;
+                lane[l].finals = remain + 1 + LENGTH <= BLOCK ? 1 : 2;
+                lane[l].finish = lane[l].buffer;
+                lane[l].offset = next++;
+                lane[l].active = true;
+
+                byte_t *tail = lane[l].buffer;
+                byte_t *stop = tail + lane[l].finals * BLOCK;
+
+                if (remain) memcpy(tail, lane[l].record + length - remain, remain);
+                memset(tail + remain, 0, stop - tail - remain);
+                tail[remain] = 0x80;
+
+                for (size_t k = 0; k < LENGTH; ++k)
+                {
+                    const byte_t value = byte_t(k < 8 ? lower >> (8 * k) : k < 16 ? upper >> (8 * (k - 8)) : 0);
+                    *(engine_t::BIGEND ? stop - 1 - k : stop - LENGTH + k) = value;
+                }
+
+                for (size_t i = 0; i < STATES; ++i)
+                {
+                    state[i * LANES + l] = start[i];
+                }
+
+                ++busy;
+            };
+
+            auto output = [&](const size_t &l)
+            {
+                byte_t result[STATES * sizeof(word_t)];
+
+                for (size_t i = 0; i < STATES; ++i)
+                {
+                    word_t value = state[i * LANES + l];
+                    value = engine_t::BIGEND ? h2be(value) : h2le(value);
+                    memcpy(result + i * sizeof(word_t), &value, sizeof(word_t));
+                }
+
+                memcpy(digests[lane[l].offset].data(), result, digests[lane[l].offset].size());
+                --busy;
+            };
+
+            for (size_t l = 0; l < LANES; ++l)
+            {
+                assign(l);
+            }
+
+            while (busy)
+            {
+                for (size_t l = 0; l < LANES; ++l)
+                {
+                    if (!lane[l].active)
+                    {
+                        block[l] = dummy;
+                    }
+                    else if (lane[l].blocks)
+                    {
+                        block[l] = lane[l].record;
+                        lane[l].record += BLOCK;
+                        lane[l].blocks -= 1;
+                    }
+                    else
+                    {
+                        block[l] = lane[l].finish;
+                        lane[l].finish += BLOCK;
+                        lane[l].finals -= 1;
+                    }
+                }
+
+                engine.compress(state, block);
+
+                for (size_t l = 0; l < LANES; ++l)
+                {
+                    if (lane[l].active && !lane[l].blocks && !lane[l].finals)
+                    {
+                        output(l);
+                        assign(l);
+                    }
+                }
+            }
+
+            memset(lane, 0, sizeof(lane));
+            memset(state, 0, sizeof(state));
+        }
+    }
+}
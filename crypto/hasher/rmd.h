@@ -24,50 +24,17 @@
  */
 
 #pragma once
+#include <array>
+#include <utility>
 #include "crypto/hasher.h"
+#include "crypto/hasher/lanes.h"
+#include "crypto/hasher/rmd/sse2.h"
+#include "crypto/hasher/rmd/avx2.h"
 
 namespace crypto
 {
-    template<size_t BITS> auto
-    rmd(const void *record, const size_t &length)
-    {
-        return hasher::RMD<BITS>().update(record, length).digest();
-    }
-
-
-    template<size_t BITS, size_t length> auto
-    rmd(const Number<length> &number)
-    {
-        return rmd<BITS>(number.data(), number.size());
-    }
-
-
-    template<size_t BITS, class char_t> auto
-    rmd(const String<char_t> &string)
-    {
-        return rmd<BITS>(string.data(), string.size());
-    }
-
-
-    template<size_t BITS> auto
-    rmd(const char *string)
-    {
-        return rmd<BITS>((void*)(string), strlen(string));
-    }
-
-
-    template<size_t BITS, class data_t> auto
-    rmd(const data_t &object)
-    {
-        return rmd<BITS>((void*)&object, sizeof(data_t));
-    }
-
-
     namespace hasher
     {
-        template<size_t BITS>
-        class RMD : public Hasher<BITS, BITS>
-        {
             template<size_t> struct Option;
 
             template<> struct Option<160>
@@ -81,10 +48,57 @@ namespace crypto
 
                 typedef uint32_t word_t;
                 typedef uint64_t long_t;
+
+                static constexpr std::array<word_t, STATES> SEED =
+                {{
+                    0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0,
+                }};
+
+                static constexpr std::array<word_t, ROUNDS> SALT =
+                {{
+                    0x00000000, 0x5A827999, 0x6ED9EBA1, 0x8F1BBCDC, 0xA953FD4E,
+                    0x50A28BE6, 0x5C4DD124, 0x6D703EF3, 0x7A6D76E9, 0x00000000,
+                }};
+
+                // word selection and rotation amounts, one row per round of
+                // either line, the right line starting at ROUNDS / 2
+
+                static constexpr int OFFS[ROUNDS][BLOCKS] =
+                {
+                    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+                    {  7,  4, 13,  1, 10,  6, 15,  3, 12,  0,  9,  5,  2, 14, 11,  8 },
+                    {  3, 10, 14,  4,  9, 15,  8,  1,  2,  7,  0,  6, 13, 11,  5, 12 },
+                    {  1,  9, 11, 10,  0,  8, 12,  4, 13,  3,  7, 15, 14,  5,  6,  2 },
+                    {  4,  0,  5,  9,  7, 12,  2, 10, 14,  1,  3,  8, 11,  6, 15, 13 },
+                    {  5, 14,  7,  0,  9,  2, 11,  4, 13,  6, 15,  8,  1, 10,  3, 12 },
+                    {  6, 11,  3,  7,  0, 13,  5, 10, 14, 15,  8, 12,  4,  9,  1,  2 },
+                    { 15,  5,  1,  3,  7, 14,  6,  9, 11,  8, 12,  2, 10,  0,  4, 13 },
+                    {  8,  6,  4,  1,  3, 11, 15,  0,  5, 12,  2, 13,  9,  7, 10, 14 },
+                    { 12, 15, 10,  4,  1,  5,  8,  7,  6,  2, 13, 14,  0,  3,  9, 11 },
+                };
+
+                static constexpr int SIZE[ROUNDS][BLOCKS] =
+                {
+                    { 11, 14, 15, 12,  5,  8,  7,  9, 11, 13, 14, 15,  6,  7,  9,  8 },
+                    {  7,  6,  8, 13, 11,  9,  7, 15,  7, 12, 15,  9, 11,  7, 13, 12 },
+                    { 11, 13,  6,  7, 14,  9, 13, 15, 14,  8, 13,  6,  5, 12,  7,  5 },
+                    { 11, 12, 14, 15, 14, 15,  9,  8,  9, 14,  5,  6,  8,  6,  5, 12 },
+                    {  9, 15,  5, 11,  6,  8, 13, 12,  5, 12, 13, 14, 11,  8,  5,  6 },
+                    {  8,  9,  9, 11, 13, 15, 15,  5,  7,  7,  8, 11, 14, 14, 12,  6 },
+                    {  9, 13, 15,  7, 12,  8,  9, 11,  7,  7, 12,  7,  6, 15, 13, 11 },
+                    {  9,  7, 15, 11,  8,  6,  6, 14, 12, 13,  5, 14, 13, 13,  7,  5 },
+                    { 15,  5,  8, 11, 14, 14,  6, 14,  6,  9, 12,  9, 12,  5, 15,  8 },
+                    {  8,  5, 12,  9, 12,  5, 14,  6,  8, 13,  6,  5, 15, 13, 11, 11 },
+                };
             };
 
+        template<size_t BITS>
+        class RMD : public Hasher<BITS, BITS, RMD<BITS>>
+        {
+            friend class Hasher<BITS, BITS, RMD>;
 
-            typedef typename Option<BITS>     option;
+            typedef typename crypto::hasher::Option<BITS>     option;
+            typedef typename Hasher<BITS, BITS, RMD>::byte_t byte_t;
             typedef typename option::word_t   word_t;
             typedef typename option::long_t   long_t;
 
@@ -94,21 +108,28 @@ namespace crypto
                 STATES   =            option::STATES,
                 BLOCKS   =            option::BLOCKS,
                 ROUNDS   =            option::ROUNDS,
+                PACKED   =  STATES * sizeof(word_t),
+                KIND     =                       'R',
             };
 
+            // the counters and chaining words share the first cache line and
+            // the block buffer starts on its own, so a context spans two
+            // lines for SHA-256/RMD-160 and four for SHA-512
+
             Number<STATES * _WORD_BIT, word_t> m_hash;
+            alignas(64)
             Number<BLOCKS * _WORD_BIT, byte_t> m_data;
 
 
         public:
 
-            static const Number<STATES * _WORD_BIT, word_t> SEED;
-            static const Number<ROUNDS * _WORD_BIT, word_t> SALT;
-            static const int               OFFS[ROUNDS][BLOCKS];
-            static const int               SIZE[ROUNDS][BLOCKS];
+            static constexpr auto         &SEED = option::SEED;
+            static constexpr auto         &SALT = option::SALT;
+            static constexpr auto         &OFFS = option::OFFS;
+            static constexpr auto         &SIZE = option::SIZE;
 
 
-            RMD() : Hasher(), m_hash{RMD::SEED}, m_data{}
+            RMD() : m_hash{RMD::SEED.data()}, m_data{}
             {
             }
 
@@ -146,137 +167,323 @@ namespace crypto
             }
 
 
-        protected:
+            // transform() runs both lines over locals; steps() unrolls all
+            // of them at compile time, so every word index, rotation amount
+            // and boolean function is fixed and each rotl() is immediate
 
+            static void
+            transform(word_t *hash, const byte_t *block, size_t count)
+            {
+                for (; count; --count, block += BLOCKS * sizeof(word_t))
+                {
+                    word_t lstate[STATES], rstate[STATES], words[BLOCKS];
 
-            void
-            compress()
+                    memcpy(lstate, hash,  sizeof(lstate));
+                    memcpy(rstate, hash,  sizeof(rstate));
+                    memcpy(words,  block, sizeof(words));
+
+                    for (size_t i = 0; i < BLOCKS; ++i)
+                    {
+                        words[i] = h2le(words[i]);
+                    }
+
+                    steps(lstate, rstate, words, std::make_index_sequence<ROUNDS / 2 * BLOCKS>());
+
+                    const word_t buffer = hash[1] + lstate[2] + rstate[3];
+                    hash[1] = hash[2] + lstate[3] + rstate[4];
+                    hash[2] = hash[3] + lstate[4] + rstate[0];
+                    hash[3] = hash[4] + lstate[0] + rstate[1];
+                    hash[4] = hash[0] + lstate[1] + rstate[2];
+                    hash[0] = buffer;
+                }
+            }
+
+
+            // oneshot() hashes a message that fits one padded block without
+            // an instance: the block is built on the stack and compressed once
+
+            static Number<BITS>
+            oneshot(const void *record, const size_t &length)
             {
-                Number<STATES * _WORD_BIT, word_t> lstate{m_hash};
-                Number<STATES * _WORD_BIT, word_t> rstate{m_hash};
-                Number<BLOCKS * _WORD_BIT, word_t> blocks{m_data};
-                word_t buffer{};
+                if (length >= BLOCKS * sizeof(word_t) - sizeof(long_t))
+                {
+                    return RMD().update(record, length).digest();
+                }
+
+                word_t hash[STATES];
+                byte_t block[BLOCKS * sizeof(word_t)];
+
+                memcpy(hash, SEED.data(), sizeof(hash));
+                memcpy(block, record, length);
+                block[length] = 0x80;
+
+                seal(block, length + 1, length);
+                transform(hash, block, 1);
 
-                for (size_t i = 0; i < BLOCKS; ++i)
+                for (size_t i = 0; i < STATES; ++i)
                 {
-                    blocks[i] = h2le(blocks[i]);
+                    hash[i] = le2h(hash[i]);
                 }
 
-                #define RMD160(s, salt, offs, size, oper) \
-                {\
-                    buffer = rotl(s[0] + oper(s[1], s[2], s[3]) + salt + blocks[offs], size);\
-                    s[0]=s[4]; s[4]=s[3]; s[3]=rotl(s[2], 10); s[2]=s[1]; s[1]=s[0] + buffer;\
+                memset(block, 0, sizeof(block));
+                return Number<BITS>((const byte_t*)hash);
+            }
+
+
+            // batch() hashes independent messages in SIMD lanes, eight per
+            // AVX2 register or four per SSE2 register, and one after another
+            // on processors with neither
+
+            static void
+            batch(const Slice *slices, Number<BITS> *digests, const size_t &count)
+            {
+                #if defined(CRYPTO_X86)
+                    if (cpu().avx2)
+                    {
+                        return lanes(RMD160x8{SALT.data(), OFFS, SIZE}, SEED.data(), slices, digests, count);
+                    }
+
+                    if (cpu().sse2)
+                    {
+                        return lanes(RMD160x4{SALT.data(), OFFS, SIZE}, SEED.data(), slices, digests, count);
+                    }
+                #endif
+
+                for (size_t i = 0; i < count; ++i)
+                {
+                    digests[i] = oneshot(slices[i].record, slices[i].length);
                 }
+            }
+
 
-                // loop on the rounds is slow due to boolean operators
-                // the optimizer fails to inline an array of functions
+            // constant() hashes a string in a constant expression and returns
+            // the digest bytes, as SHA::constant() does
 
-                for (size_t i = 0, j = i + ROUNDS / 2, k = 0; k < BLOCKS; ++k)
+            template<size_t length> static constexpr std::array<byte_t, BITS / CHAR_BIT>
+            constant(const char (&string)[length])
+            {
+                return constant(string, length - 1);
+            }
+
+
+            static constexpr std::array<byte_t, BITS / CHAR_BIT>
+            constant(const char *record, const size_t &length)
+            {
+                constexpr size_t BLOCK = BLOCKS * sizeof(word_t);
+
+                const size_t total = (length + sizeof(long_t) + BLOCK) / BLOCK * BLOCK;
+                const long_t bits  = long_t(length) * CHAR_BIT;
+
+                word_t hash[STATES] = {};
+                std::array<byte_t, BITS / CHAR_BIT> digest = {};
+
+                for (size_t i = 0; i < STATES; ++i)
                 {
-                    RMD160(lstate, SALT[i], OFFS[i][k], SIZE[i][k], boop150);
-                    RMD160(rstate, SALT[j], OFFS[j][k], SIZE[j][k], boop045);
+                    hash[i] = SEED[i];
                 }
 
-                for (size_t i = 1, j = i + ROUNDS / 2, k = 0; k < BLOCKS; ++k)
+                for (size_t offset = 0; offset < total; offset += BLOCK)
                 {
-                    RMD160(lstate, SALT[i], OFFS[i][k], SIZE[i][k], boop202);
-                    RMD160(rstate, SALT[j], OFFS[j][k], SIZE[j][k], boop228);
+                    word_t lstate[STATES] = {}, rstate[STATES] = {}, words[BLOCKS] = {};
+
+                    for (size_t i = 0; i < BLOCK; ++i)
+                    {
+                        const size_t k = offset + i, q = BLOCK - 1 - i;
+                        const byte_t byte = k <  length ? byte_t(record[k])
+                                          : k == length ? byte_t(0x80)
+                                          : offset + BLOCK == total && q < sizeof(bits)
+                                          ? byte_t(bits >> ((sizeof(bits) - 1 - q) * CHAR_BIT)) : byte_t(0);
+
+                        words[i / sizeof(word_t)] |= word_t(byte) << (i % sizeof(word_t) * CHAR_BIT);
+                    }
+
+                    for (size_t i = 0; i < STATES; ++i)
+                    {
+                        lstate[i] = rstate[i] = hash[i];
+                    }
+
+                    steps(lstate, rstate, words, std::make_index_sequence<ROUNDS / 2 * BLOCKS>());
+
+                    const word_t buffer = hash[1] + lstate[2] + rstate[3];
+                    hash[1] = hash[2] + lstate[3] + rstate[4];
+                    hash[2] = hash[3] + lstate[4] + rstate[0];
+                    hash[3] = hash[4] + lstate[0] + rstate[1];
+                    hash[4] = hash[0] + lstate[1] + rstate[2];
+                    hash[0] = buffer;
                 }
 
-                for (size_t i = 2, j = i + ROUNDS / 2, k = 0; k < BLOCKS; ++k)
+                for (size_t i = 0; i < digest.size(); ++i)
                 {
-                    RMD160(lstate, SALT[i], OFFS[i][k], SIZE[i][k], boop089);
-                    RMD160(rstate, SALT[j], OFFS[j][k], SIZE[j][k], boop089);
+                    digest[i] = byte_t(hash[i / sizeof(word_t)] >> (i % sizeof(word_t) * CHAR_BIT));
                 }
 
-                for (size_t i = 3, j = i + ROUNDS / 2, k = 0; k < BLOCKS; ++k)
+                return digest;
+            }
+
+
+        protected:
+
+
+            template<size_t... I> static constexpr void
+            steps(word_t (&l)[STATES], word_t (&r)[STATES], const word_t (&w)[BLOCKS], std::index_sequence<I...>)
+            {
+                (step<I>(l, r, w), ...);
+            }
+
+
+            template<size_t I> static constexpr void
+            step(word_t (&l)[STATES], word_t (&r)[STATES], const word_t (&w)[BLOCKS])
+            {
+                line<I / BLOCKS, I>(l, w);
+                line<I / BLOCKS + ROUNDS / 2, I>(r, w);
+            }
+
+
+            // line() rotates the names of the five variables instead of the
+            // values; 80 steps bring them back to their original places
+
+            template<size_t R, size_t I> static constexpr void
+            line(word_t (&s)[STATES], const word_t (&w)[BLOCKS])
+            {
+                constexpr size_t a = (5 - I % 5) % 5, b = (6 - I % 5) % 5, c = (7 - I % 5) % 5;
+                constexpr size_t d = (8 - I % 5) % 5, e = (9 - I % 5) % 5, k = I % BLOCKS;
+
+                s[a] = rotl(word_t(s[a] + boop<R>(s[b], s[c], s[d]) + SALT[R] + w[OFFS[R][k]]), SIZE[R][k]) + s[e];
+                s[c] = rotl(s[c], 10);
+            }
+
+
+            template<size_t R> static constexpr word_t
+            boop(const word_t &x, const word_t &y, const word_t &z)
+            {
+                if constexpr (R == 0 || R == 9) return boop150(x, y, z);
+                if constexpr (R == 1 || R == 8) return boop202(x, y, z);
+                if constexpr (R == 2 || R == 7) return boop089(x, y, z);
+                if constexpr (R == 3 || R == 6) return boop228(x, y, z);
+                if constexpr (R == 4 || R == 5) return boop045(x, y, z);
+            }
+
+
+            void
+            compress(const byte_t *block, size_t count)
+            {
+                transform(this->m_hash.data(), block, count);
+            }
+
+
+            void
+            initialize()
+            {
+                memcpy(this->m_hash.data(), RMD::SEED.data(), sizeof(RMD::SEED));
+            }
+
+
+            // pack() and unpack() move the five chaining words to and from the
+            // little-endian form used by checkpoints
+
+            void
+            pack(byte_t *record) const
+            {
+                for (size_t i = 0; i < STATES; ++i)
                 {
-                    RMD160(lstate, SALT[i], OFFS[i][k], SIZE[i][k], boop228);
-                    RMD160(rstate, SALT[j], OFFS[j][k], SIZE[j][k], boop202);
+                    const word_t word = h2le(this->m_hash[i]);
+                    memcpy(record + i * sizeof(word_t), &word, sizeof(word_t));
                 }
+            }
 
-                for (size_t i = 4, j = i + ROUNDS / 2, k = 0; k < BLOCKS; ++k)
+
+            void
+            unpack(const byte_t *record)
+            {
+                for (size_t i = 0; i < STATES; ++i)
                 {
-                    RMD160(lstate, SALT[i], OFFS[i][k], SIZE[i][k], boop045);
-                    RMD160(rstate, SALT[j], OFFS[j][k], SIZE[j][k], boop150);
+                    word_t word;
+                    memcpy(&word, record + i * sizeof(word_t), sizeof(word_t));
+                    this->m_hash[i] = le2h(word);
                 }
+            }
+
+
+            // seal() zeroes the block from tail up to the length field and
+            // stores the message length in bits there, little-endian
 
-                #undef RMD160
+            static void
+            seal(byte_t *block, const size_t &tail, const size_t &length)
+            {
+                const long_t bits = h2le(long_t(length) * CHAR_BIT);
 
-                buffer    = m_hash[1] + lstate[2] + rstate[3];
-                m_hash[1] = m_hash[2] + lstate[3] + rstate[4];
-                m_hash[2] = m_hash[3] + lstate[4] + rstate[0];
-                m_hash[3] = m_hash[4] + lstate[0] + rstate[1];
-                m_hash[4] = m_hash[0] + lstate[1] + rstate[2];
-                m_hash[0] = buffer;
+                memset(block + tail, 0, BLOCKS * sizeof(word_t) - sizeof(long_t) - tail);
+                memcpy(block + BLOCKS * sizeof(word_t) - sizeof(long_t), &bits, sizeof(bits));
             }
 
 
             void
             finalize()
             {
-                const size_t length  =  this->size();
-                this->update(size_t(1), byte_t(0x80));
+                byte_t *block = this->data();
+                size_t  tail  = size_t(this->end() - block);
+
+                block[tail++] = 0x80;
 
-                if (this->reserve() < sizeof(long_t))
+                if (tail > this->capacity() - sizeof(long_t))
                 {
-                    this->update(this->reserve(), 0x0);
+                    memset(block + tail, 0, this->capacity() - tail);
+                    this->compress(block, 1);
+                    tail = 0;
                 }
 
-                this->update(reserve() - sizeof(long_t), 0x0);
-                this->update(h2le(long_t(length) * CHAR_BIT));
+                seal(block, tail, this->size());
+                this->compress(block, 1);
 
                 for (size_t i = 0; i < STATES; ++i)
                 {
                     this->m_hash[i] = le2h(this->m_hash[i]);
                 }
+
+                memset(this->data(), 0, this->capacity());
             }
         };
+    }
 
+    template<size_t BITS> auto
+    rmd(const void *record, const size_t &length)
+    {
+        return hasher::RMD<BITS>::oneshot(record, length);
+    }
 
-        // RMD<160>
 
-        template<>
-        decltype(RMD<160>::SEED) RMD<160>::SEED =
-        {
-            0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0,
-        };
+    template<size_t BITS> void
+    rmd(const Slice *slices, Number<BITS> *digests, const size_t &count)
+    {
+        hasher::RMD<BITS>::batch(slices, digests, count);
+    }
 
-        template<>
-        decltype(RMD<160>::SALT) RMD<160>::SALT =
-        {
-            0x00000000, 0x5A827999, 0x6ED9EBA1, 0x8F1BBCDC, 0xA953FD4E,
-            0x50A28BE6, 0x5C4DD124, 0x6D703EF3, 0x7A6D76E9, 0x00000000,
-        };
 
-        template<>
-        decltype(RMD<160>::OFFS) RMD<160>::OFFS =
-        {
-            {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
-            {  7,  4, 13,  1, 10,  6, 15,  3, 12,  0,  9,  5,  2, 14, 11,  8 },
-            {  3, 10, 14,  4,  9, 15,  8,  1,  2,  7,  0,  6, 13, 11,  5, 12 },
-            {  1,  9, 11, 10,  0,  8, 12,  4, 13,  3,  7, 15, 14,  5,  6,  2 },
-            {  4,  0,  5,  9,  7, 12,  2, 10, 14,  1,  3,  8, 11,  6, 15, 13 },
-            {  5, 14,  7,  0,  9,  2, 11,  4, 13,  6, 15,  8,  1, 10,  3, 12 },
-            {  6, 11,  3,  7,  0, 13,  5, 10, 14, 15,  8, 12,  4,  9,  1,  2 },
-            { 15,  5,  1,  3,  7, 14,  6,  9, 11,  8, 12,  2, 10,  0,  4, 13 },
-            {  8,  6,  4,  1,  3, 11, 15,  0,  5, 12,  2, 13,  9,  7, 10, 14 },
-            { 12, 15, 10,  4,  1,  5,  8,  7,  6,  2, 13, 14,  0,  3,  9, 11 },
-        };
+    template<size_t BITS, size_t length> auto
+    rmd(const Number<length> &number)
+    {
+        return rmd<BITS>(number.data(), number.size());
+    }
 
-        template<>
-        decltype(RMD<160>::SIZE) RMD<160>::SIZE =
-        {
-            { 11, 14, 15, 12,  5,  8,  7,  9, 11, 13, 14, 15,  6,  7,  9,  8 },
-            {  7,  6,  8, 13, 11,  9,  7, 15,  7, 12, 15,  9, 11,  7, 13, 12 },
-            { 11, 13,  6,  7, 14,  9, 13, 15, 14,  8, 13,  6,  5, 12,  7,  5 },
-            { 11, 12, 14, 15, 14, 15,  9,  8,  9, 14,  5,  6,  8,  6,  5, 12 },
-            {  9, 15,  5, 11,  6,  8, 13, 12,  5, 12, 13, 14, 11,  8,  5,  6 },
-            {  8,  9,  9, 11, 13, 15, 15,  5,  7,  7,  8, 11, 14, 14, 12,  6 },
-            {  9, 13, 15,  7, 12,  8,  9, 11,  7,  7, 12,  7,  6, 15, 13, 11 },
-            {  9,  7, 15, 11,  8,  6,  6, 14, 12, 13,  5, 14, 13, 13,  7,  5 },
-            { 15,  5,  8, 11, 14, 14,  6, 14,  6,  9, 12,  9, 12,  5, 15,  8 },
-            {  8,  5, 12,  9, 12,  5, 14,  6,  8, 13,  6,  5, 15, 13, 11, 11 },
-        };
+
+    template<size_t BITS, class char_t> auto
+    rmd(const String<char_t> &string)
+    {
+        return rmd<BITS>(string.data(), string.size());
     }
+
+
+    template<size_t BITS> auto
+    rmd(const char *string)
+    {
+        return rmd<BITS>((void*)(string), strlen(string));
+    }
+
+
+    template<size_t BITS, class data_t> auto
+    rmd(const data_t &object)
+    {
+        return rmd<BITS>((void*)&object, sizeof(data_t));
+    }
+
 }
@@ -0,0 +1,189 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Quasis (info@quasis.io)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+#include "crypto/cpu.h"
+
+#if defined(CRYPTO_X86)
+
+namespace crypto
+{
+    namespace hasher
+    {
+        // RMD160x8
+        //
+        // Eight RIPEMD-160 compressions side by side, one message per 32-bit
+        // lane of an AVX2 register, with the state layout and tables of
+        // RMD160x4.
+
+
+        struct RMD160x8
+        {
+            static constexpr size_t LANES  = 8;
+            static constexpr size_t STATES = 5;
+            static constexpr bool   BIGEND = false;
+
+            typedef uint32_t word_t;
+
+            const uint32_t *salt;
+            const int     (*offs)[16];
+            const int     (*size)[16];
+
+
+            CRYPTO_TARGET("avx2") void
+            compress(uint32_t *state, const uint8_t *const *block) const
+            {
+                __m256i words[16], lstate[5], rstate[5], buffer;
+
+                for (size_t j = 0; j < 2; ++j)
+                {
+                    __m256i r[8], t[8];
+
+                    for (size_t l = 0; l < 8; ++l)
+                    {
+                        r[l] = _mm256_loadu_si256((const __m256i*)(block[l] + 32 * j));
+                    }
+
+                    for (size_t l = 0; l < 8; l += 2)
+                    {
+                        t[l + 0] = _mm256_unpacklo_epi32(r[l], r[l + 1]);
+                        t[l + 1] = _mm256_unpackhi_epi32(r[l], r[l + 1]);
+                    }
+
+                    for (size_t l = 0; l < 8; l += 4)
+                    {
+                        r[l + 0] = _mm256_unpacklo_epi64(t[l + 0], t[l + 2]);
+                        r[l + 1] = _mm256_unpackhi_epi64(t[l + 0], t[l + 2]);
+                        r[l + 2] = _mm256_unpacklo_epi64(t[l + 1], t[l + 3]);
+                        r[l + 3] = _mm256_unpackhi_epi64(t[l + 1], t[l + 3]);
+                    }
+
+                    for (size_t l = 0; l < 4; ++l)
+                    {
+                        words[8 * j + l + 0] = _mm256_permute2x128_si256(r[l], r[l + 4], 0x20);
+                        words[8 * j + l + 4] = _mm256_permute2x128_si256(r[l], r[l + 4], 0x31);
+                    }
+                }
+
+                for (size_t i = 0; i < 5; ++i)
+                {
+                    lstate[i] = rstate[i] = _mm256_loadu_si256((const __m256i*)(state + 8 * i));
+                }
+
+                #define RMD160(s, salt, offs, size, oper)\
+                {\
+                    buffer = rotl(_mm256_add_epi32(_mm256_add_epi32(s[0], oper(s[1], s[2], s[3])),\
+                                  _mm256_add_epi32(_mm256_set1_epi32(int(salt)), words[offs])), size);\
+                    s[0]=s[4]; s[4]=s[3]; s[3]=rotl(s[2], 10); s[2]=s[1]; s[1]=_mm256_add_epi32(s[0], buffer);\
+                }
+
+                for (size_t i = 0, j = i + 5, k = 0; k < 16; ++k)
+                {
+                    RMD160(lstate, salt[i], offs[i][k], size[i][k], boop150);
+                    RMD160(rstate, salt[j], offs[j][k], size[j][k], boop045);
+                }
+
+                for (size_t i = 1, j = i + 5, k = 0; k < 16; ++k)
+                {
+                    RMD160(lstate, salt[i], offs[i][k], size[i][k], boop202);
+                    RMD160(rstate, salt[j], offs[j][k], size[j][k], boop228);
+                }
+
+                for (size_t i = 2, j = i + 5, k = 0; k < 16; ++k)
+                {
+                    RMD160(lstate, salt[i], offs[i][k], size[i][k], boop089);
+                    RMD160(rstate, salt[j], offs[j][k], size[j][k], boop089);
+                }
+
+                for (size_t i = 3, j = i + 5, k = 0; k < 16; ++k)
+                {
+                    RMD160(lstate, salt[i], offs[i][k], size[i][k], boop228);
+                    RMD160(rstate, salt[j], offs[j][k], size[j][k], boop202);
+                }
+
+                for (size_t i = 4, j = i + 5, k = 0; k < 16; ++k)
+                {
+                    RMD160(lstate, salt[i], offs[i][k], size[i][k], boop045);
+                    RMD160(rstate, salt[j], offs[j][k], size[j][k], boop150);
+                }
+
+                #undef RMD160
+
+                const __m256i h0 = _mm256_loadu_si256((const __m256i*)(state +  0));
+                const __m256i h1 = _mm256_loadu_si256((const __m256i*)(state +  8));
+                const __m256i h2 = _mm256_loadu_si256((const __m256i*)(state + 16));
+                const __m256i h3 = _mm256_loadu_si256((const __m256i*)(state + 24));
+                const __m256i h4 = _mm256_loadu_si256((const __m256i*)(state + 32));
+
+                _mm256_storeu_si256((__m256i*)(state +  0), _mm256_add_epi32(h1, _mm256_add_epi32(lstate[2], rstate[3])));
+                _mm256_storeu_si256((__m256i*)(state +  8), _mm256_add_epi32(h2, _mm256_add_epi32(lstate[3], rstate[4])));
+                _mm256_storeu_si256((__m256i*)(state + 16), _mm256_add_epi32(h3, _mm256_add_epi32(lstate[4], rstate[0])));
+                _mm256_storeu_si256((__m256i*)(state + 24), _mm256_add_epi32(h4, _mm256_add_epi32(lstate[0], rstate[1])));
+                _mm256_storeu_si256((__m256i*)(state + 32), _mm256_add_epi32(h0, _mm256_add_epi32(lstate[1], rstate[2])));
+            }
+
+
+        private:
+
+            CRYPTO_TARGET("avx2") static __m256i
+            rotl(const __m256i &x, const int &n)
+            {
+                return _mm256_or_si256(_mm256_sll_epi32(x, _mm_cvtsi32_si128(n)), _mm256_srl_epi32(x, _mm_cvtsi32_si128(32 - n)));
+            }
+
+            CRYPTO_TARGET("avx2") static __m256i
+            boop045(const __m256i &x, const __m256i &y, const __m256i &z)
+            {
+                return _mm256_xor_si256(x, _mm256_or_si256(y, _mm256_xor_si256(z, _mm256_set1_epi32(-1))));
+            }
+
+            CRYPTO_TARGET("avx2") static __m256i
+            boop089(const __m256i &x, const __m256i &y, const __m256i &z)
+            {
+                return _mm256_xor_si256(_mm256_or_si256(x, _mm256_xor_si256(y, _mm256_set1_epi32(-1))), z);
+            }
+
+            CRYPTO_TARGET("avx2") static __m256i
+            boop150(const __m256i &x, const __m256i &y, const __m256i &z)
+            {
+                return _mm256_xor_si256(_mm256_xor_si256(x, y), z);
+            }
+
+            CRYPTO_TARGET("avx2") static __m256i
+            boop202(const __m256i &x, const __m256i &y, const __m256i &z)
+            {
+                return _mm256_xor_si256(_mm256_and_si256(x, _mm256_xor_si256(y, z)), z);
+            }
+
+            CRYPTO_TARGET("avx2") static __m256i
+            boop228(const __m256i &x, const __m256i &y, const __m256i &z)
+            {
+                return _mm256_or_si256(_mm256_and_si256(x, z), _mm256_andnot_si256(z, y));
+            }
+        };
+    }
+}
+
+#endif
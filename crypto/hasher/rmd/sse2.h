@@ -0,0 +1,178 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Quasis (info@quasis.io)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+#include "crypto/cpu.h"
+
+#if defined(CRYPTO_X86)
+
+namespace crypto
+{
+    namespace hasher
+    {
+        // RMD160x4
+        //
+        // Four RIPEMD-160 compressions side by side, one message per 32-bit
+        // lane of an SSE2 register. The state is word-major: state[4 * i + l]
+        // is word i of lane l. Both lines run on the same lanes; the word and
+        // rotation tables are the scalar OFFS and SIZE.
+
+
+        struct RMD160x4
+        {
+            static constexpr size_t LANES  = 4;
+            static constexpr size_t STATES = 5;
+            static constexpr bool   BIGEND = false;
+
+            typedef uint32_t word_t;
+
+            const uint32_t *salt;
+            const int     (*offs)[16];
+            const int     (*size)[16];
+
+
+            CRYPTO_TARGET("sse2") void
+            compress(uint32_t *state, const uint8_t *const *block) const
+            {
+                __m128i words[16], lstate[5], rstate[5], buffer;
+
+                for (size_t j = 0; j < 4; ++j)
+                {
+                    const __m128i r0 = _mm_loadu_si128((const __m128i*)(block[0] + 16 * j));
+                    const __m128i r1 = _mm_loadu_si128((const __m128i*)(block[1] + 16 * j));
+                    const __m128i r2 = _mm_loadu_si128((const __m128i*)(block[2] + 16 * j));
+                    const __m128i r3 = _mm_loadu_si128((const __m128i*)(block[3] + 16 * j));
+
+                    const __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+                    const __m128i t1 = _mm_unpackhi_epi32(r0, r1);
+                    const __m128i t2 = _mm_unpacklo_epi32(r2, r3);
+                    const __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+
+                    words[4 * j + 0] = _mm_unpacklo_epi64(t0, t2);
+                    words[4 * j + 1] = _mm_unpackhi_epi64(t0, t2);
+                    words[4 * j + 2] = _mm_unpacklo_epi64(t1, t3);
+                    words[4 * j + 3] = _mm_unpackhi_epi64(t1, t3);
+                }
+
+                for (size_t i = 0; i < 5; ++i)
+                {
+                    lstate[i] = rstate[i] = _mm_loadu_si128((const __m128i*)(state + 4 * i));
+                }
+
+                #define RMD160(s, salt, offs, size, oper)\
+                {\
+                    buffer = rotl(_mm_add_epi32(_mm_add_epi32(s[0], oper(s[1], s[2], s[3])),\
+                                  _mm_add_epi32(_mm_set1_epi32(int(salt)), words[offs])), size);\
+                    s[0]=s[4]; s[4]=s[3]; s[3]=rotl(s[2], 10); s[2]=s[1]; s[1]=_mm_add_epi32(s[0], buffer);\
+                }
+
+                for (size_t i = 0, j = i + 5, k = 0; k < 16; ++k)
+                {
+                    RMD160(lstate, salt[i], offs[i][k], size[i][k], boop150);
+                    RMD160(rstate, salt[j], offs[j][k], size[j][k], boop045);
+                }
+
+                for (size_t i = 1, j = i + 5, k = 0; k < 16; ++k)
+                {
+                    RMD160(lstate, salt[i], offs[i][k], size[i][k], boop202);
+                    RMD160(rstate, salt[j], offs[j][k], size[j][k], boop228);
+                }
+
+                for (size_t i = 2, j = i + 5, k = 0; k < 16; ++k)
+                {
+                    RMD160(lstate, salt[i], offs[i][k], size[i][k], boop089);
+                    RMD160(rstate, salt[j], offs[j][k], size[j][k], boop089);
+                }
+
+                for (size_t i = 3, j = i + 5, k = 0; k < 16; ++k)
+                {
+                    RMD160(lstate, salt[i], offs[i][k], size[i][k], boop228);
+                    RMD160(rstate, salt[j], offs[j][k], size[j][k], boop202);
+                }
+
+                for (size_t i = 4, j = i + 5, k = 0; k < 16; ++k)
+                {
+                    RMD160(lstate, salt[i], offs[i][k], size[i][k], boop045);
+                    RMD160(rstate, salt[j], offs[j][k], size[j][k], boop150);
+                }
+
+                #undef RMD160
+
+                const __m128i h0 = _mm_loadu_si128((const __m128i*)(state +  0));
+                const __m128i h1 = _mm_loadu_si128((const __m128i*)(state +  4));
+                const __m128i h2 = _mm_loadu_si128((const __m128i*)(state +  8));
+                const __m128i h3 = _mm_loadu_si128((const __m128i*)(state + 12));
+                const __m128i h4 = _mm_loadu_si128((const __m128i*)(state + 16));
+
+                _mm_storeu_si128((__m128i*)(state +  0), _mm_add_epi32(h1, _mm_add_epi32(lstate[2], rstate[3])));
+                _mm_storeu_si128((__m128i*)(state +  4), _mm_add_epi32(h2, _mm_add_epi32(lstate[3], rstate[4])));
+                _mm_storeu_si128((__m128i*)(state +  8), _mm_add_epi32(h3, _mm_add_epi32(lstate[4], rstate[0])));
+                _mm_storeu_si128((__m128i*)(state + 12), _mm_add_epi32(h4, _mm_add_epi32(lstate[0], rstate[1])));
+                _mm_storeu_si128((__m128i*)(state + 16), _mm_add_epi32(h0, _mm_add_epi32(lstate[1], rstate[2])));
+            }
+
+
+        private:
+
+            CRYPTO_TARGET("sse2") static __m128i
+            rotl(const __m128i &x, const int &n)
+            {
+                return _mm_or_si128(_mm_sll_epi32(x, _mm_cvtsi32_si128(n)), _mm_srl_epi32(x, _mm_cvtsi32_si128(32 - n)));
+            }
+
+            CRYPTO_TARGET("sse2") static __m128i
+            boop045(const __m128i &x, const __m128i &y, const __m128i &z)
+            {
+                return _mm_xor_si128(x, _mm_or_si128(y, _mm_xor_si128(z, _mm_set1_epi32(-1))));
+            }
+
+            CRYPTO_TARGET("sse2") static __m128i
+            boop089(const __m128i &x, const __m128i &y, const __m128i &z)
+            {
+                return _mm_xor_si128(_mm_or_si128(x, _mm_xor_si128(y, _mm_set1_epi32(-1))), z);
+            }
+
+            CRYPTO_TARGET("sse2") static __m128i
+            boop150(const __m128i &x, const __m128i &y, const __m128i &z)
+            {
+                return _mm_xor_si128(_mm_xor_si128(x, y), z);
+            }
+
+            CRYPTO_TARGET("sse2") static __m128i
+            boop202(const __m128i &x, const __m128i &y, const __m128i &z)
+            {
+                return _mm_xor_si128(_mm_and_si128(x, _mm_xor_si128(y, z)), z);
+            }
+
+            CRYPTO_TARGET("sse2") static __m128i
+            boop228(const __m128i &x, const __m128i &y, const __m128i &z)
+            {
+                return _mm_or_si128(_mm_and_si128(x, z), _mm_andnot_si128(z, y));
+            }
+        };
+    }
+}
+
+#endif
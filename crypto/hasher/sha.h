@@ -24,7 +24,15 @@
  */
 
 #pragma once
+#include <array>
+#include <utility>
 #include "crypto/hasher.h"
+#include "crypto/hasher/lanes.h"
+#include "crypto/hasher/sha/rounds.h"
+#include "crypto/hasher/sha/shani.h"
+#include "crypto/hasher/sha/ssse3.h"
+#include "crypto/hasher/sha/avx2.h"
+#include "crypto/hasher/sha/avx512.h"
 
 namespace crypto
 {
@@ -35,49 +43,158 @@ namespace crypto
 
             template<> struct Option<256>
             {
-                static constexpr size_t STATES = 16;
+                static constexpr size_t STATES =  8;
                 static constexpr size_t BLOCKS = 16;
                 static constexpr size_t ROUNDS = 64;
 
                 typedef uint32_t  word_t;
                 typedef uint64_t  long_t;
+
+                static constexpr std::array<word_t, ROUNDS> SALT =
+                {{
+                    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5,
+                    0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+                    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3,
+                    0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+                    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC,
+                    0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+                    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7,
+                    0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+                    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13,
+                    0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+                    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3,
+                    0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+                    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5,
+                    0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+                    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208,
+                    0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2,
+                }};
+
+                // seed() is the initial hash of the variant truncated to VITS
+
+                template<size_t VITS> static constexpr std::array<word_t, STATES>
+                seed()
+                {
+                    static_assert(VITS == 224 || VITS == 256, "SHA-256 is truncated to 224 or 256 bits");
+
+                    if constexpr (VITS == 224) return
+                    {{
+                        0xC1059ED8, 0x367CD507, 0x3070DD17, 0xF70E5939,
+                        0xFFC00B31, 0x68581511, 0x64F98FA7, 0xBEFA4FA4,
+                    }};
+
+                    else return
+                    {{
+                        0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+                        0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19,
+                    }};
+                }
             };
 
             template<> struct Option<512>
             {
-                static constexpr size_t STATES = 16;
+                static constexpr size_t STATES =  8;
                 static constexpr size_t BLOCKS = 16;
                 static constexpr size_t ROUNDS = 80;
 
                 typedef uint64_t  word_t;
                 typedef uint128_t long_t;
+
+                static constexpr std::array<word_t, ROUNDS> SALT =
+                {{
+                    0x428A2F98D728AE22, 0x7137449123EF65CD, 0xB5C0FBCFEC4D3B2F, 0xE9B5DBA58189DBBC,
+                    0x3956C25BF348B538, 0x59F111F1B605D019, 0x923F82A4AF194F9B, 0xAB1C5ED5DA6D8118,
+                    0xD807AA98A3030242, 0x12835B0145706FBE, 0x243185BE4EE4B28C, 0x550C7DC3D5FFB4E2,
+                    0x72BE5D74F27B896F, 0x80DEB1FE3B1696B1, 0x9BDC06A725C71235, 0xC19BF174CF692694,
+                    0xE49B69C19EF14AD2, 0xEFBE4786384F25E3, 0x0FC19DC68B8CD5B5, 0x240CA1CC77AC9C65,
+                    0x2DE92C6F592B0275, 0x4A7484AA6EA6E483, 0x5CB0A9DCBD41FBD4, 0x76F988DA831153B5,
+                    0x983E5152EE66DFAB, 0xA831C66D2DB43210, 0xB00327C898FB213F, 0xBF597FC7BEEF0EE4,
+                    0xC6E00BF33DA88FC2, 0xD5A79147930AA725, 0x06CA6351E003826F, 0x142929670A0E6E70,
+                    0x27B70A8546D22FFC, 0x2E1B21385C26C926, 0x4D2C6DFC5AC42AED, 0x53380D139D95B3DF,
+                    0x650A73548BAF63DE, 0x766A0ABB3C77B2A8, 0x81C2C92E47EDAEE6, 0x92722C851482353B,
+                    0xA2BFE8A14CF10364, 0xA81A664BBC423001, 0xC24B8B70D0F89791, 0xC76C51A30654BE30,
+                    0xD192E819D6EF5218, 0xD69906245565A910, 0xF40E35855771202A, 0x106AA07032BBD1B8,
+                    0x19A4C116B8D2D0C8, 0x1E376C085141AB53, 0x2748774CDF8EEB99, 0x34B0BCB5E19B48A8,
+                    0x391C0CB3C5C95A63, 0x4ED8AA4AE3418ACB, 0x5B9CCA4F7763E373, 0x682E6FF3D6B2B8A3,
+                    0x748F82EE5DEFB2FC, 0x78A5636F43172F60, 0x84C87814A1F0AB72, 0x8CC702081A6439EC,
+                    0x90BEFFFA23631E28, 0xA4506CEBDE82BDE9, 0xBEF9A3F7B2C67915, 0xC67178F2E372532B,
+                    0xCA273ECEEA26619C, 0xD186B8C721C0C207, 0xEADA7DD6CDE0EB1E, 0xF57D4F7FEE6ED178,
+                    0x06F067AA72176FBA, 0x0A637DC5A2C898A6, 0x113F9804BEF90DAE, 0x1B710B35131C471B,
+                    0x28DB77F523047D84, 0x32CAAB7B40C72493, 0x3C9EBE0A15C9BEBC, 0x431D67C49C100D4C,
+                    0x4CC5D4BECB3E42B6, 0x597F299CFC657E2A, 0x5FCB6FAB3AD6FAEC, 0x6C44198C4A475817,
+                }};
+
+                // seed() is the initial hash of the variant truncated to VITS
+
+                template<size_t VITS> static constexpr std::array<word_t, STATES>
+                seed()
+                {
+                    static_assert(VITS == 224 || VITS == 256 || VITS == 384 || VITS == 512, "SHA-512 is truncated to 224, 256, 384 or 512 bits");
+
+                    if constexpr (VITS == 224) return
+                    {{
+                        0x8C3D37C819544DA2, 0x73E1996689DCD4D6, 0x1DFAB7AE32FF9C82, 0x679DD514582F9FCF,
+                        0x0F6D2B697BD44DA8, 0x77E36F7304C48942, 0x3F9D85A86A1D36C8, 0x1112E6AD91D692A1,
+                    }};
+
+                    else if constexpr (VITS == 256) return
+                    {{
+                        0x22312194FC2BF72C, 0x9F555FA3C84C64C2, 0x2393B86B6F53B151, 0x963877195940EABD,
+                        0x96283EE2A88EFFE3, 0xBE5E1E2553863992, 0x2B0199FC2C85B8AA, 0x0EB72DDC81C52CA2,
+                    }};
+
+                    else if constexpr (VITS == 384) return
+                    {{
+                        0xCBBB9D5DC1059ED8, 0x629A292A367CD507, 0x9159015A3070DD17, 0x152FECD8F70E5939,
+                        0x67332667FFC00B31, 0x8EB44A8768581511, 0xDB0C2E0D64F98FA7, 0x47B5481DBEFA4FA4,
+                    }};
+
+                    else return
+                    {{
+                        0x6A09E667F3BCC908, 0xBB67AE8584CAA73B, 0x3C6EF372FE94F82B, 0xA54FF53A5F1D36F1,
+                        0x510E527FADE682D1, 0x9B05688C2B3E6C1F, 0x1F83D9ABFB41BD6B, 0x5BE0CD19137E2179,
+                    }};
+                }
             };
 
         template<size_t BITS, size_t VITS = BITS>
-        class SHA : public Hasher<BITS, VITS>
+        class SHA : public Hasher<BITS, VITS, SHA<BITS, VITS>>
         {
+            friend class Hasher<BITS, VITS, SHA>;
+
+            template<size_t, size_t> friend class HMAC;
 
             typedef typename crypto::hasher::Option<BITS>     option;
-	    typedef typename Hasher<BITS, VITS>::byte_t byte_t;
+	    typedef typename Hasher<BITS, VITS, SHA>::byte_t byte_t;
             typedef typename option::word_t   word_t;
             typedef typename option::long_t   long_t;
 
+            static_assert(BITS == 256 ? VITS == 224 || VITS == 256 : VITS == 224 || VITS == 256 || VITS == 384 || VITS == 512,
+                          "SHA-256 digests are 224 or 256 bits and SHA-512 digests 224, 256, 384 or 512");
+
             static constexpr size_t _WORD_BIT = sizeof(word_t) * CHAR_BIT;
             static constexpr size_t STATES   =            option::STATES;
             static constexpr size_t BLOCKS   =            option::BLOCKS;
             static constexpr size_t ROUNDS   =            option::ROUNDS;
+            static constexpr size_t PACKED   =  STATES * sizeof(word_t);
+            static constexpr size_t KIND     =                       'S';
+
+            // the counters and chaining words share the first cache line and
+            // the block buffer starts on its own, so a context spans two
+            // lines for SHA-256/RMD-160 and four for SHA-512
 
             Number<STATES * _WORD_BIT, word_t> m_hash;
+            alignas(64)
             Number<BLOCKS * _WORD_BIT, byte_t> m_data;
 
 
         public:
 
-            static const Number<STATES * _WORD_BIT, word_t> SEED;
-            static const Number<ROUNDS * _WORD_BIT, word_t> SALT;
+            static constexpr std::array<word_t, STATES> SEED = option::template seed<VITS>();
+            static constexpr auto                      &SALT = option::SALT;
 
 
-            SHA() : m_hash{SHA::SEED}, m_data{}
+            SHA() : m_hash{SHA::SEED.data()}, m_data{}
             {
             }
 
@@ -115,225 +232,328 @@ namespace crypto
             }
 
 
-        protected:
+            typedef void (*kernel_t)(word_t*, const byte_t*, size_t);
+            typedef void (*salted_t)(word_t*, const word_t*, const byte_t*, size_t);
 
 
-            void
-            compress()
-            {
-                Number<STATES * _WORD_BIT, word_t> states{m_hash};
-                Number<ROUNDS * _WORD_BIT, word_t> rounds{m_data};
+            // transform() keeps a rolling 16-word message schedule and the
+            // eight working variables in locals; rounds() unrolls every round
+            // at compile time, so indices and constants are all immediate.
+            // Nothing is wiped per block: finalize() clears the buffer once
 
-                for (size_t i = 0; i < BLOCKS; ++i)
+            static void
+            transform(word_t *hash, const byte_t *block, size_t count)
+            {
+                for (; count; --count, block += BLOCKS * sizeof(word_t))
                 {
-                    rounds[i] = h2be(rounds[i]);
+                    word_t states[STATES], words[BLOCKS];
+
+                    memcpy(states, hash,  sizeof(states));
+                    memcpy(words,  block, sizeof(words));
+
+                    for (size_t i = 0; i < BLOCKS; ++i)
+                    {
+                        words[i] = be2h(words[i]);
+                    }
+
+                    rounds(states, words, std::make_index_sequence<ROUNDS>());
+
+                    for (size_t i = 0; i < STATES; ++i)
+                    {
+                        hash[i] += states[i];
+                    }
                 }
+            }
 
-                for (size_t i = BLOCKS; i < ROUNDS; ++i)
+
+            // the kernel is chosen once, on first use, from the features
+            // reported by cpuid: the SHA extensions, then the SIMD message
+            // schedules, with transform() as the portable fallback
+
+            static kernel_t
+            kernel()
+            {
+                static const kernel_t instance = []() -> kernel_t
                 {
-                    rounds[i] = rounds[i-16] + sigma0(rounds[i-15]) + rounds[i-7] + sigma1(rounds[i-2]);
-                }
+                    #if defined(CRYPTO_X86)
+                        if constexpr (BITS == 256)
+                        {
+                            if (cpu().sha)                 return &SHA::salted<sha256ni>;
+                            if (cpu().avx2 && cpu().bmi2)  return &SHA::salted<sha256avx2>;
+                            if (cpu().ssse3)               return &SHA::salted<sha256ssse3>;
+                        }
+
+                        if constexpr (BITS == 512)
+                        {
+                            if (cpu().avx2 && cpu().bmi2)  return &SHA::salted<sha512avx2>;
+                            if (cpu().ssse3)               return &SHA::salted<sha512ssse3>;
+                        }
+                    #endif
+
+                    return &SHA::transform;
+                }();
+
+                return instance;
+            }
+
 
-                for (size_t i = 0; i < ROUNDS; ++i)
+            // oneshot() hashes a message that fits one padded block without
+            // an instance: the block is built on the stack and compressed once
+
+            static Number<VITS>
+            oneshot(const void *record, const size_t &length)
+            {
+                if (length >= BLOCKS * sizeof(word_t) - sizeof(long_t))
                 {
-                    word_t t0 = delta0(states[0]) + boop232(states[0], states[1], states[2]);
-                    word_t t1 = delta1(states[4]) + boop202(states[4], states[5], states[6])
-                              + states[7] + rounds[i] + SHA<BITS,BITS>::SALT[i];
-
-                    states[7] = states[6];
-                    states[6] = states[5];
-                    states[5] = states[4];
-                    states[4] = states[3] + t1;
-                    states[3] = states[2];
-                    states[2] = states[1];
-                    states[1] = states[0];
-                    states[0] = t1 + t0;
+                    return SHA().update(record, length).digest();
                 }
 
+                word_t hash[STATES];
+                byte_t block[BLOCKS * sizeof(word_t)];
+
+                memcpy(hash, SEED.data(), sizeof(hash));
+                memcpy(block, record, length);
+                block[length] = 0x80;
+
+                seal(block, length + 1, length);
+                kernel()(hash, block, 1);
+
                 for (size_t i = 0; i < STATES; ++i)
                 {
-                    this->m_hash[i] += states[i];
+                    hash[i] = be2h(hash[i]);
                 }
+
+                memset(block, 0, sizeof(block));
+                return Number<VITS>((const byte_t*)hash);
             }
 
 
-            void
-            finalize()
-            {
-                const size_t length  =  this->size();
-                this->update(size_t(1), byte_t(0x80));
+            // batch() hashes independent messages in SIMD lanes: eight
+            // SHA-256 streams in AVX2 unless the processor has the SHA
+            // extensions, whose single stream already outruns them, and four
+            // or eight SHA-512 streams in AVX2 or AVX-512. Without any of
+            // these it hashes one message after another
 
-                if (this->reserve() < sizeof(long_t))
+            static void
+            batch(const Slice *slices, Number<VITS> *digests, const size_t &count)
+            {
+                #if defined(CRYPTO_X86)
+                    if constexpr (BITS == 256)
+                    {
+                        if (cpu().avx2 && !cpu().sha)
+                        {
+                            return lanes(SHA256x8{SHA<BITS, BITS>::SALT.data()}, SEED.data(), slices, digests, count);
+                        }
+                    }
+
+                    if constexpr (BITS == 512)
+                    {
+                        if (cpu().avx512)
+                        {
+                            return lanes(SHA512x8{SHA<BITS, BITS>::SALT.data()}, SEED.data(), slices, digests, count);
+                        }
+
+                        if (cpu().avx2)
+                        {
+                            return lanes(SHA512x4{SHA<BITS, BITS>::SALT.data()}, SEED.data(), slices, digests, count);
+                        }
+                    }
+                #endif
+
+                for (size_t i = 0; i < count; ++i)
                 {
-                    this->update(this->reserve(), 0x0);
+                    digests[i] = oneshot(slices[i].record, slices[i].length);
                 }
+            }
+
 
-                this->update(this->reserve() - sizeof(long_t), 0x0);
-                this->update(h2be(long_t(length) * CHAR_BIT));
+            // constant() hashes a string in a constant expression. Number is
+            // not a literal type before C++20, so the digest comes back as the
+            // same bytes in a std::array, ready to be turned into a Number
+
+            template<size_t length> static constexpr std::array<byte_t, VITS / CHAR_BIT>
+            constant(const char (&string)[length])
+            {
+                return constant(string, length - 1);
+            }
+
+
+            static constexpr std::array<byte_t, VITS / CHAR_BIT>
+            constant(const char *record, const size_t &length)
+            {
+                constexpr size_t BLOCK = BLOCKS * sizeof(word_t);
+
+                const size_t   total = (length + sizeof(long_t) + BLOCK) / BLOCK * BLOCK;
+                const uint64_t bits  = uint64_t(length) * CHAR_BIT;
+
+                word_t hash[STATES] = {};
+                std::array<byte_t, VITS / CHAR_BIT> digest = {};
 
                 for (size_t i = 0; i < STATES; ++i)
                 {
-                    this->m_hash[i] = be2h(this->m_hash[i]);
+                    hash[i] = SEED[i];
                 }
-            }
 
+                for (size_t offset = 0; offset < total; offset += BLOCK)
+                {
+                    word_t states[STATES] = {}, words[BLOCKS] = {};
 
-            static uint32_t
-            sigma0(const uint32_t &number)
-            {
-                return rotr(number, 7) ^ rotr(number,18) ^ (number >>  3);
-            }
+                    for (size_t i = 0; i < BLOCK; ++i)
+                    {
+                        const size_t k = offset + i, q = total - 1 - k;
+                        const byte_t byte = k <  length ? byte_t(record[k])
+                                          : k == length ? byte_t(0x80)
+                                          : q <  sizeof(bits) ? byte_t(bits >> (q * CHAR_BIT)) : byte_t(0);
 
+                        words[i / sizeof(word_t)] |= word_t(byte) << ((sizeof(word_t) - 1 - i % sizeof(word_t)) * CHAR_BIT);
+                    }
 
-            static uint64_t
-            sigma0(const uint64_t &number)
-            {
-                return rotr(number, 1) ^ rotr(number, 8) ^ (number >>  7);
+                    for (size_t i = 0; i < STATES; ++i)
+                    {
+                        states[i] = hash[i];
+                    }
+
+                    rounds(states, words, std::make_index_sequence<ROUNDS>());
+
+                    for (size_t i = 0; i < STATES; ++i)
+                    {
+                        hash[i] += states[i];
+                    }
+                }
+
+                for (size_t i = 0; i < digest.size(); ++i)
+                {
+                    digest[i] = byte_t(hash[i / sizeof(word_t)] >> ((sizeof(word_t) - 1 - i % sizeof(word_t)) * CHAR_BIT));
+                }
+
+                return digest;
             }
 
 
-            static uint32_t
-            sigma1(const uint32_t &number)
+        protected:
+
+
+            template<size_t... I> static constexpr void
+            rounds(word_t (&states)[STATES], word_t (&words)[BLOCKS], std::index_sequence<I...>)
             {
-                return rotr(number,17) ^ rotr(number,19) ^ (number >> 10);
+                (round<I>(states, words), ...);
             }
 
 
-            static uint64_t
-            sigma1(const uint64_t &number)
+            template<size_t I> static constexpr void
+            round(word_t (&s)[STATES], word_t (&w)[BLOCKS])
             {
-                return rotr(number,19) ^ rotr(number,61) ^ (number >>  6);
+                if constexpr (I >= BLOCKS)
+                {
+                    w[I % 16] += sigma0(w[(I + 1) % 16]) + w[(I + 9) % 16] + sigma1(w[(I + 14) % 16]);
+                }
+
+                sha2round(s[(8 - I % 8) % 8], s[(9 - I % 8) % 8], s[(10 - I % 8) % 8], s[(11 - I % 8) % 8],
+                          s[(12 - I % 8) % 8], s[(13 - I % 8) % 8], s[(14 - I % 8) % 8], s[(15 - I % 8) % 8],
+                          word_t(w[I % 16] + SHA<BITS, BITS>::SALT[I]));
             }
 
 
-            static uint32_t
-            delta0(const uint32_t &number)
+            template<salted_t KERNEL> static void
+            salted(word_t *hash, const byte_t *block, size_t count)
             {
-                return rotr(number, 2) ^ rotr(number,13) ^ rotr(number,22);
+                KERNEL(hash, SHA<BITS, BITS>::SALT.data(), block, count);
             }
 
 
-            static uint64_t
-            delta0(const uint64_t &number)
+            void
+            compress(const byte_t *block, size_t count)
             {
-                return rotr(number,28) ^ rotr(number,34) ^ rotr(number,39);
+                kernel()(this->m_hash.data(), block, count);
             }
 
 
-            static uint32_t
-            delta1(const uint32_t &number)
+            void
+            initialize()
             {
-                return rotr(number, 6) ^ rotr(number,11) ^ rotr(number,25);
+                memcpy(this->m_hash.data(), SHA::SEED.data(), sizeof(SHA::SEED));
             }
 
 
-            static uint64_t
-            delta1(const uint64_t &number)
+            // pack() and unpack() move the chaining words to and from the
+            // little-endian form used by checkpoints
+
+            void
+            pack(byte_t *record) const
             {
-                return rotr(number,14) ^ rotr(number,18) ^ rotr(number,41);
+                for (size_t i = 0; i < STATES; ++i)
+                {
+                    const word_t word = h2le(this->m_hash[i]);
+                    memcpy(record + i * sizeof(word_t), &word, sizeof(word_t));
+                }
             }
-        };
 
 
-        // SHA<256>
+            void
+            unpack(const byte_t *record)
+            {
+                for (size_t i = 0; i < STATES; ++i)
+                {
+                    word_t word;
+                    memcpy(&word, record + i * sizeof(word_t), sizeof(word_t));
+                    this->m_hash[i] = le2h(word);
+                }
+            }
 
 
-        template<>
-        decltype(SHA<256, 224>::SEED) SHA<256, 224>::SEED =
-        {
-            0xC1059ED8, 0x367CD507, 0x3070DD17, 0xF70E5939,
-            0xFFC00B31, 0x68581511, 0x64F98FA7, 0xBEFA4FA4,
-        };
+            // seal() zeroes the block from tail up to the length field and
+            // stores the message length in bits there, big-endian. HMAC seals
+            // its blocks here too, with lengths that count the key block
 
-        template<>
-        decltype(SHA<256, 256>::SEED) SHA<256, 256>::SEED =
-        {
-            0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
-            0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19,
-        };
+            static void
+            seal(byte_t *block, const size_t &tail, const size_t &length)
+            {
+                const long_t bits = h2be(long_t(length) * CHAR_BIT);
 
-        template<>
-        decltype(SHA<256, 256>::SALT) SHA<256, 256>::SALT =
-        {
-            0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5,
-            0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
-            0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3,
-            0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
-            0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC,
-            0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
-            0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7,
-            0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
-            0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13,
-            0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
-            0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3,
-            0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
-            0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5,
-            0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
-            0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208,
-            0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2,
-        };
+                memset(block + tail, 0, BLOCKS * sizeof(word_t) - sizeof(long_t) - tail);
+                memcpy(block + BLOCKS * sizeof(word_t) - sizeof(long_t), &bits, sizeof(bits));
+            }
 
 
-        // SHA<512>
+            void
+            finalize()
+            {
+                byte_t *block = this->data();
+                size_t  tail  = size_t(this->end() - block);
 
-        template<>
-        decltype(SHA<512, 224>::SEED) SHA<512, 224>::SEED =
-        {
-            0x8C3D37C819544DA2, 0x73E1996689DCD4D6, 0x1DFAB7AE32FF9C82, 0x679DD514582F9FCF,
-            0x0F6D2B697BD44DA8, 0x77E36F7304C48942, 0x3F9D85A86A1D36C8, 0x1112E6AD91D692A1,
-        };
+                block[tail++] = 0x80;
 
-        template<>
-        decltype(SHA<512, 256>::SEED) SHA<512, 256>::SEED =
-        {
-            0x22312194FC2BF72C, 0x9F555FA3C84C64C2, 0x2393B86B6F53B151, 0x963877195940EABD,
-            0x96283EE2A88EFFE3, 0xBE5E1E2553863992, 0x2B0199FC2C85B8AA, 0x0EB72DDC81C52CA2,
-        };
+                if (tail > this->capacity() - sizeof(long_t))
+                {
+                    memset(block + tail, 0, this->capacity() - tail);
+                    this->compress(block, 1);
+                    tail = 0;
+                }
 
-        template<>
-        decltype(SHA<512, 384>::SEED) SHA<512, 384>::SEED =
-        {
-            0xCBBB9D5DC1059ED8, 0x629A292A367CD507, 0x9159015A3070DD17, 0x152FECD8F70E5939,
-            0x67332667FFC00B31, 0x8EB44A8768581511, 0xDB0C2E0D64F98FA7, 0x47B5481DBEFA4FA4,
-        };
+                seal(block, tail, this->size());
+                this->compress(block, 1);
 
-        template<>
-        decltype(SHA<512, 512>::SEED) SHA<512, 512>::SEED =
-        {
-            0x6A09E667F3BCC908, 0xBB67AE8584CAA73B, 0x3C6EF372FE94F82B, 0xA54FF53A5F1D36F1,
-            0x510E527FADE682D1, 0x9B05688C2B3E6C1F, 0x1F83D9ABFB41BD6B, 0x5BE0CD19137E2179,
-        };
+                for (size_t i = 0; i < STATES; ++i)
+                {
+                    this->m_hash[i] = be2h(this->m_hash[i]);
+                }
 
-        template<>
-        decltype(SHA<512, 512>::SALT) SHA<512, 512>::SALT =
-        {
-            0x428A2F98D728AE22, 0x7137449123EF65CD, 0xB5C0FBCFEC4D3B2F, 0xE9B5DBA58189DBBC,
-            0x3956C25BF348B538, 0x59F111F1B605D019, 0x923F82A4AF194F9B, 0xAB1C5ED5DA6D8118,
-            0xD807AA98A3030242, 0x12835B0145706FBE, 0x243185BE4EE4B28C, 0x550C7DC3D5FFB4E2,
-            0x72BE5D74F27B896F, 0x80DEB1FE3B1696B1, 0x9BDC06A725C71235, 0xC19BF174CF692694,
-            0xE49B69C19EF14AD2, 0xEFBE4786384F25E3, 0x0FC19DC68B8CD5B5, 0x240CA1CC77AC9C65,
-            0x2DE92C6F592B0275, 0x4A7484AA6EA6E483, 0x5CB0A9DCBD41FBD4, 0x76F988DA831153B5,
-            0x983E5152EE66DFAB, 0xA831C66D2DB43210, 0xB00327C898FB213F, 0xBF597FC7BEEF0EE4,
-            0xC6E00BF33DA88FC2, 0xD5A79147930AA725, 0x06CA6351E003826F, 0x142929670A0E6E70,
-            0x27B70A8546D22FFC, 0x2E1B21385C26C926, 0x4D2C6DFC5AC42AED, 0x53380D139D95B3DF,
-            0x650A73548BAF63DE, 0x766A0ABB3C77B2A8, 0x81C2C92E47EDAEE6, 0x92722C851482353B,
-            0xA2BFE8A14CF10364, 0xA81A664BBC423001, 0xC24B8B70D0F89791, 0xC76C51A30654BE30,
-            0xD192E819D6EF5218, 0xD69906245565A910, 0xF40E35855771202A, 0x106AA07032BBD1B8,
-            0x19A4C116B8D2D0C8, 0x1E376C085141AB53, 0x2748774CDF8EEB99, 0x34B0BCB5E19B48A8,
-            0x391C0CB3C5C95A63, 0x4ED8AA4AE3418ACB, 0x5B9CCA4F7763E373, 0x682E6FF3D6B2B8A3,
-            0x748F82EE5DEFB2FC, 0x78A5636F43172F60, 0x84C87814A1F0AB72, 0x8CC702081A6439EC,
-            0x90BEFFFA23631E28, 0xA4506CEBDE82BDE9, 0xBEF9A3F7B2C67915, 0xC67178F2E372532B,
-            0xCA273ECEEA26619C, 0xD186B8C721C0C207, 0xEADA7DD6CDE0EB1E, 0xF57D4F7FEE6ED178,
-            0x06F067AA72176FBA, 0x0A637DC5A2C898A6, 0x113F9804BEF90DAE, 0x1B710B35131C471B,
-            0x28DB77F523047D84, 0x32CAAB7B40C72493, 0x3C9EBE0A15C9BEBC, 0x431D67C49C100D4C,
-            0x4CC5D4BECB3E42B6, 0x597F299CFC657E2A, 0x5FCB6FAB3AD6FAEC, 0x6C44198C4A475817,
+                memset(this->data(), 0, this->capacity());
+            }
         };
     }
 
     template<size_t BITS, size_t VITS = BITS> auto
     sha(const void *record, const size_t &length)
     {
-        return crypto::hasher::SHA<BITS, VITS>().update(record, length).digest();
+        return crypto::hasher::SHA<BITS, VITS>::oneshot(record, length);
+    }
+
+
+    template<size_t BITS, size_t VITS = BITS> void
+    sha(const Slice *slices, Number<VITS> *digests, const size_t &count)
+    {
+        crypto::hasher::SHA<BITS, VITS>::batch(slices, digests, count);
     }
 
 
@@ -0,0 +1,418 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Quasis (info@quasis.io)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+#include "crypto/cpu.h"
+#include "crypto/hasher/sha/rounds.h"
+
+#if defined(CRYPTO_X86)
+
+namespace crypto
+{
+    namespace hasher
+    {
+        // SHA256x8
+        //
+        // Eight SHA-256 compressions side by side, one message per 32-bit lane
+        // of an AVX2 register. The state is word-major: state[8 * i + l] is
+        // word i of lane l. Blocks are transposed into lanes with unpack and
+        // permute instead of gathers.
+
+
+        struct SHA256x8
+        {
+            static constexpr size_t LANES  = 8;
+            static constexpr size_t STATES = 8;
+            static constexpr bool   BIGEND = true;
+
+            typedef uint32_t word_t;
+
+            const uint32_t *salt;
+
+
+            CRYPTO_TARGET("avx2") void
+            compress(uint32_t *state, const uint8_t *const *block) const
+            {
+                const __m256i order = _mm256_set_epi64x(
+                    0x0C0D0E0F08090A0BULL, 0x0405060700010203ULL,
+                    0x0C0D0E0F08090A0BULL, 0x0405060700010203ULL);
+
+                __m256i words[16], s[8];
+
+                for (size_t j = 0; j < 2; ++j)
+                {
+                    __m256i r[8], t[8];
+
+                    for (size_t l = 0; l < 8; ++l)
+                    {
+                        r[l] = _mm256_loadu_si256((const __m256i*)(block[l] + 32 * j));
+                    }
+
+                    for (size_t l = 0; l < 8; l += 2)
+                    {
+                        t[l + 0] = _mm256_unpacklo_epi32(r[l], r[l + 1]);
+                        t[l + 1] = _mm256_unpackhi_epi32(r[l], r[l + 1]);
+                    }
+
+                    for (size_t l = 0; l < 8; l += 4)
+                    {
+                        r[l + 0] = _mm256_unpacklo_epi64(t[l + 0], t[l + 2]);
+                        r[l + 1] = _mm256_unpackhi_epi64(t[l + 0], t[l + 2]);
+                        r[l + 2] = _mm256_unpacklo_epi64(t[l + 1], t[l + 3]);
+                        r[l + 3] = _mm256_unpackhi_epi64(t[l + 1], t[l + 3]);
+                    }
+
+                    for (size_t l = 0; l < 4; ++l)
+                    {
+                        words[8 * j + l + 0] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r[l], r[l + 4], 0x20), order);
+                        words[8 * j + l + 4] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r[l], r[l + 4], 0x31), order);
+                    }
+                }
+
+                for (size_t i = 0; i < 8; ++i)
+                {
+                    s[i] = _mm256_loadu_si256((const __m256i*)(state + 8 * i));
+                }
+
+                __m256i a = s[0], b = s[1], c = s[2], d = s[3];
+                __m256i e = s[4], f = s[5], g = s[6], h = s[7];
+
+                #define ROTR(x, n)\
+                    _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n))
+
+                #define XOR3(x, y, z)\
+                    _mm256_xor_si256(_mm256_xor_si256(x, y), z)
+
+                for (size_t i = 0; i < 64; ++i)
+                {
+                    __m256i &w = words[i & 15];
+
+                    if (i >= 16)
+                    {
+                        const __m256i w15 = words[(i +  1) & 15];
+                        const __m256i w02 = words[(i + 14) & 15];
+
+                        w = _mm256_add_epi32(_mm256_add_epi32(w, words[(i + 9) & 15]), _mm256_add_epi32(
+                            XOR3(ROTR(w15,  7), ROTR(w15, 18), _mm256_srli_epi32(w15,  3)),
+                            XOR3(ROTR(w02, 17), ROTR(w02, 19), _mm256_srli_epi32(w02, 10))));
+                    }
+
+                    const __m256i t1 = _mm256_add_epi32(
+                        _mm256_add_epi32(h, XOR3(ROTR(e, 6), ROTR(e, 11), ROTR(e, 25))),
+                        _mm256_add_epi32(
+                            _mm256_xor_si256(_mm256_and_si256(_mm256_xor_si256(f, g), e), g),
+                            _mm256_add_epi32(w, _mm256_set1_epi32(int(salt[i])))));
+
+                    const __m256i t0 = _mm256_add_epi32(
+                        XOR3(ROTR(a, 2), ROTR(a, 13), ROTR(a, 22)),
+                        _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(_mm256_xor_si256(a, b), c)));
+
+                    h = g; g = f; f = e; e = _mm256_add_epi32(d, t1);
+                    d = c; c = b; b = a; a = _mm256_add_epi32(t1, t0);
+                }
+
+                #undef XOR3
+                #undef ROTR
+
+                s[0] = _mm256_add_epi32(s[0], a); s[1] = _mm256_add_epi32(s[1], b);
+                s[2] = _mm256_add_epi32(s[2], c); s[3] = _mm256_add_epi32(s[3], d);
+                s[4] = _mm256_add_epi32(s[4], e); s[5] = _mm256_add_epi32(s[5], f);
+                s[6] = _mm256_add_epi32(s[6], g); s[7] = _mm256_add_epi32(s[7], h);
+
+                for (size_t i = 0; i < 8; ++i)
+                {
+                    _mm256_storeu_si256((__m256i*)(state + 8 * i), s[i]);
+                }
+            }
+        };
+
+
+        // SHA512x4
+        //
+        // Four SHA-512 compressions side by side, one message per 64-bit lane
+        // of an AVX2 register, with the same word-major state as SHA256x8.
+        // AVX2 has no 64-bit rotate, so rotations are shift pairs.
+
+
+        struct SHA512x4
+        {
+            static constexpr size_t LANES  = 4;
+            static constexpr size_t STATES = 8;
+            static constexpr bool   BIGEND = true;
+
+            typedef uint64_t word_t;
+
+            const uint64_t *salt;
+
+
+            CRYPTO_TARGET("avx2") void
+            compress(uint64_t *state, const uint8_t *const *block) const
+            {
+                const __m256i order = _mm256_set_epi64x(
+                    0x08090A0B0C0D0E0FULL, 0x0001020304050607ULL,
+                    0x08090A0B0C0D0E0FULL, 0x0001020304050607ULL);
+
+                __m256i words[16], s[8];
+
+                for (size_t j = 0; j < 4; ++j)
+                {
+                    __m256i r[4], t[4];
+
+                    for (size_t l = 0; l < 4; ++l)
+                    {
+                        r[l] = _mm256_loadu_si256((const __m256i*)(block[l] + 32 * j));
+                    }
+
+                    t[0] = _mm256_unpacklo_epi64(r[0], r[1]);
+                    t[1] = _mm256_unpackhi_epi64(r[0], r[1]);
+                    t[2] = _mm256_unpacklo_epi64(r[2], r[3]);
+                    t[3] = _mm256_unpackhi_epi64(r[2], r[3]);
+
+                    words[4 * j + 0] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(t[0], t[2], 0x20), order);
+                    words[4 * j + 1] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(t[1], t[3], 0x20), order);
+                    words[4 * j + 2] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(t[0], t[2], 0x31), order);
+                    words[4 * j + 3] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(t[1], t[3], 0x31), order);
+                }
+
+                for (size_t i = 0; i < 8; ++i)
+                {
+                    s[i] = _mm256_loadu_si256((const __m256i*)(state + 4 * i));
+                }
+
+                __m256i a = s[0], b = s[1], c = s[2], d = s[3];
+                __m256i e = s[4], f = s[5], g = s[6], h = s[7];
+
+                #define ROTR(x, n)\
+                    _mm256_or_si256(_mm256_srli_epi64(x, n), _mm256_slli_epi64(x, 64 - n))
+
+                #define XOR3(x, y, z)\
+                    _mm256_xor_si256(_mm256_xor_si256(x, y), z)
+
+                for (size_t i = 0; i < 80; ++i)
+                {
+                    __m256i &w = words[i & 15];
+
+                    if (i >= 16)
+                    {
+                        const __m256i w15 = words[(i +  1) & 15];
+                        const __m256i w02 = words[(i + 14) & 15];
+
+                        w = _mm256_add_epi64(_mm256_add_epi64(w, words[(i + 9) & 15]), _mm256_add_epi64(
+                            XOR3(ROTR(w15,  1), ROTR(w15,  8), _mm256_srli_epi64(w15, 7)),
+                            XOR3(ROTR(w02, 19), ROTR(w02, 61), _mm256_srli_epi64(w02, 6))));
+                    }
+
+                    const __m256i t1 = _mm256_add_epi64(
+                        _mm256_add_epi64(h, XOR3(ROTR(e, 14), ROTR(e, 18), ROTR(e, 41))),
+                        _mm256_add_epi64(
+                            _mm256_xor_si256(_mm256_and_si256(_mm256_xor_si256(f, g), e), g),
+                            _mm256_add_epi64(w, _mm256_set1_epi64x((long long)salt[i]))));
+
+                    const __m256i t0 = _mm256_add_epi64(
+                        XOR3(ROTR(a, 28), ROTR(a, 34), ROTR(a, 39)),
+                        _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(_mm256_xor_si256(a, b), c)));
+
+                    h = g; g = f; f = e; e = _mm256_add_epi64(d, t1);
+                    d = c; c = b; b = a; a = _mm256_add_epi64(t1, t0);
+                }
+
+                #undef XOR3
+                #undef ROTR
+
+                s[0] = _mm256_add_epi64(s[0], a); s[1] = _mm256_add_epi64(s[1], b);
+                s[2] = _mm256_add_epi64(s[2], c); s[3] = _mm256_add_epi64(s[3], d);
+                s[4] = _mm256_add_epi64(s[4], e); s[5] = _mm256_add_epi64(s[5], f);
+                s[6] = _mm256_add_epi64(s[6], g); s[7] = _mm256_add_epi64(s[7], h);
+
+                for (size_t i = 0; i < 8; ++i)
+                {
+                    _mm256_storeu_si256((__m256i*)(state + 4 * i), s[i]);
+                }
+            }
+        };
+
+
+        // sha256avx2()
+        //
+        // Single-stream SHA-256 for processors without the SHA extensions. The
+        // schedules of two consecutive blocks are expanded together, one per
+        // 128-bit half, interleaved with the rounds of the first block; the
+        // second block then runs on the stored schedule. The rounds compile to
+        // rorx.
+
+
+        CRYPTO_TARGET("avx2,bmi2") inline void
+        sha256avx2(uint32_t *hash, const uint32_t *salt, const uint8_t *block, size_t count)
+        {
+            const __m256i order = _mm256_set_epi64x(
+                0x0C0D0E0F08090A0BULL, 0x0405060700010203ULL,
+                0x0C0D0E0F08090A0BULL, 0x0405060700010203ULL);
+
+            #define ROTR(x, n)\
+                _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n))
+
+            #define SIGMA0(x)\
+                _mm256_xor_si256(_mm256_xor_si256(ROTR(x,  7), ROTR(x, 18)), _mm256_srli_epi32(x,  3))
+
+            #define SIGMA1(x)\
+                _mm256_xor_si256(_mm256_xor_si256(ROTR(x, 17), ROTR(x, 19)), _mm256_srli_epi32(x, 10))
+
+            #define LOAD(i)\
+                _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(\
+                    _mm_loadu_si128((const __m128i*)(block + 16 * i))),\
+                    _mm_loadu_si128((const __m128i*)(next  + 16 * i)), 1), order)
+
+            #define QUAD(a, b, c, d, e, f, g, h, i)\
+            {\
+                const __m256i k = _mm256_add_epi32(x0, _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(salt + i))));\
+                _mm_storeu_si128((__m128i*)(sched[0] + i), _mm256_castsi256_si128(k));\
+                _mm_storeu_si128((__m128i*)(sched[1] + i), _mm256_extracti128_si256(k, 1));\
+                __m256i w = x0;\
+                if (i < 48)\
+                {\
+                    w = _mm256_add_epi32(_mm256_add_epi32(x0, SIGMA0(_mm256_alignr_epi8(x1, x0, 4))), _mm256_alignr_epi8(x3, x2, 4));\
+                    w = _mm256_add_epi32(w, _mm256_bsrli_epi128(SIGMA1(x3), 8));\
+                    w = _mm256_add_epi32(w, _mm256_bslli_epi128(SIGMA1(w ), 8));\
+                }\
+                sha2round(a, b, c, d, e, f, g, h, sched[0][i + 0]);\
+                sha2round(h, a, b, c, d, e, f, g, sched[0][i + 1]);\
+                sha2round(g, h, a, b, c, d, e, f, sched[0][i + 2]);\
+                sha2round(f, g, h, a, b, c, d, e, sched[0][i + 3]);\
+                x0 = x1; x1 = x2; x2 = x3; x3 = w;\
+            }
+
+            uint32_t sched[2][64];
+
+            while (count)
+            {
+                const uint8_t *next = count > 1 ? block + 64 : block;
+
+                uint32_t a = hash[0], b = hash[1], c = hash[2], d = hash[3];
+                uint32_t e = hash[4], f = hash[5], g = hash[6], h = hash[7];
+
+                __m256i x0 = LOAD(0), x1 = LOAD(1), x2 = LOAD(2), x3 = LOAD(3);
+
+                for (size_t i = 0; i < 64; i += 8)
+                {
+                    QUAD(a, b, c, d, e, f, g, h, i + 0);
+                    QUAD(e, f, g, h, a, b, c, d, i + 4);
+                }
+
+                hash[0] += a; hash[1] += b; hash[2] += c; hash[3] += d;
+                hash[4] += e; hash[5] += f; hash[6] += g; hash[7] += h;
+
+                block += 64; count -= 1;
+
+                if (count)
+                {
+                    sha2rounds(hash, sched[1], 64);
+                    block += 64; count -= 1;
+                }
+            }
+
+            #undef QUAD
+            #undef LOAD
+            #undef SIGMA1
+            #undef SIGMA0
+            #undef ROTR
+        }
+
+
+        // sha512avx2()
+        //
+        // Single-stream SHA-512 with the schedule expanded four words at a
+        // time, interleaved with the rounds; words cross the 128-bit halves
+        // with vperm2i128, and sigma1 is added in two halves as in
+        // sha256ssse3().
+
+
+        CRYPTO_TARGET("avx2,bmi2") inline void
+        sha512avx2(uint64_t *hash, const uint64_t *salt, const uint8_t *block, size_t count)
+        {
+            const __m256i order = _mm256_set_epi64x(
+                0x08090A0B0C0D0E0FULL, 0x0001020304050607ULL,
+                0x08090A0B0C0D0E0FULL, 0x0001020304050607ULL);
+
+            #define ROTR(x, n)\
+                _mm256_or_si256(_mm256_srli_epi64(x, n), _mm256_slli_epi64(x, 64 - n))
+
+            #define SIGMA0(x)\
+                _mm256_xor_si256(_mm256_xor_si256(ROTR(x,  1), ROTR(x,  8)), _mm256_srli_epi64(x, 7))
+
+            #define SIGMA1(x)\
+                _mm256_xor_si256(_mm256_xor_si256(ROTR(x, 19), ROTR(x, 61)), _mm256_srli_epi64(x, 6))
+
+            #define SHIFT(x, y)\
+                _mm256_alignr_epi8(_mm256_permute2x128_si256(x, y, 0x21), x, 8)
+
+            #define QUAD(a, b, c, d, e, f, g, h, i)\
+            {\
+                _mm256_storeu_si256((__m256i*)sched, _mm256_add_epi64(x0, _mm256_loadu_si256((const __m256i*)(salt + i))));\
+                __m256i w = x0;\
+                if (i < 64)\
+                {\
+                    w = _mm256_add_epi64(_mm256_add_epi64(x0, SIGMA0(SHIFT(x0, x1))), SHIFT(x2, x3));\
+                    w = _mm256_add_epi64(w, _mm256_permute2x128_si256(SIGMA1(x3), SIGMA1(x3), 0x81));\
+                    w = _mm256_add_epi64(w, _mm256_permute2x128_si256(SIGMA1(w ), SIGMA1(w ), 0x08));\
+                }\
+                sha2round(a, b, c, d, e, f, g, h, sched[0]);\
+                sha2round(h, a, b, c, d, e, f, g, sched[1]);\
+                sha2round(g, h, a, b, c, d, e, f, sched[2]);\
+                sha2round(f, g, h, a, b, c, d, e, sched[3]);\
+                x0 = x1; x1 = x2; x2 = x3; x3 = w;\
+            }
+
+            uint64_t sched[4];
+
+            for (; count; --count, block += 128)
+            {
+                uint64_t a = hash[0], b = hash[1], c = hash[2], d = hash[3];
+                uint64_t e = hash[4], f = hash[5], g = hash[6], h = hash[7];
+
+                __m256i x0 = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(block +  0)), order);
+                __m256i x1 = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(block + 32)), order);
+                __m256i x2 = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(block + 64)), order);
+                __m256i x3 = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(block + 96)), order);
+
+                for (size_t i = 0; i < 80; i += 8)
+                {
+                    QUAD(a, b, c, d, e, f, g, h, i + 0);
+                    QUAD(e, f, g, h, a, b, c, d, i + 4);
+                }
+
+                hash[0] += a; hash[1] += b; hash[2] += c; hash[3] += d;
+                hash[4] += e; hash[5] += f; hash[6] += g; hash[7] += h;
+            }
+
+            #undef QUAD
+            #undef SHIFT
+            #undef SIGMA1
+            #undef SIGMA0
+            #undef ROTR
+        }
+    }
+}
+
+#endif
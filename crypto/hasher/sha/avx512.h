@@ -0,0 +1,148 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Quasis (info@quasis.io)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+#include "crypto/cpu.h"
+
+#if defined(CRYPTO_X86)
+
+namespace crypto
+{
+    namespace hasher
+    {
+        // SHA512x8
+        //
+        // Eight SHA-512 compressions side by side, one message per 64-bit lane
+        // of an AVX-512 register. Rotations use vprorq and the boolean
+        // functions a single vpternlogq each, keyed by the same truth tables
+        // that name boop150(), boop202() and boop232().
+
+
+        struct SHA512x8
+        {
+            static constexpr size_t LANES  = 8;
+            static constexpr size_t STATES = 8;
+            static constexpr bool   BIGEND = true;
+
+            typedef uint64_t word_t;
+
+            const uint64_t *salt;
+
+
+            CRYPTO_TARGET("avx512f,avx512bw") void
+            compress(uint64_t *state, const uint8_t *const *block) const
+            {
+                const __m512i order = _mm512_set_epi64(
+                    0x08090A0B0C0D0E0FULL, 0x0001020304050607ULL,
+                    0x08090A0B0C0D0E0FULL, 0x0001020304050607ULL,
+                    0x08090A0B0C0D0E0FULL, 0x0001020304050607ULL,
+                    0x08090A0B0C0D0E0FULL, 0x0001020304050607ULL);
+
+                __m512i words[16], s[8];
+
+                for (size_t j = 0; j < 2; ++j)
+                {
+                    __m512i r[8], t[8], u[8];
+
+                    for (size_t l = 0; l < 8; ++l)
+                    {
+                        r[l] = _mm512_loadu_si512((const void*)(block[l] + 64 * j));
+                    }
+
+                    for (size_t l = 0; l < 8; l += 2)
+                    {
+                        t[l + 0] = _mm512_unpacklo_epi64(r[l], r[l + 1]);
+                        t[l + 1] = _mm512_unpackhi_epi64(r[l], r[l + 1]);
+                    }
+
+                    for (size_t l = 0; l < 2; ++l)
+                    {
+                        u[l + 0] = _mm512_shuffle_i64x2(t[l + 0], t[l + 2], 0x88);
+                        u[l + 2] = _mm512_shuffle_i64x2(t[l + 0], t[l + 2], 0xDD);
+                        u[l + 4] = _mm512_shuffle_i64x2(t[l + 4], t[l + 6], 0x88);
+                        u[l + 6] = _mm512_shuffle_i64x2(t[l + 4], t[l + 6], 0xDD);
+                    }
+
+                    for (size_t l = 0; l < 4; ++l)
+                    {
+                        words[8 * j + l + 0] = _mm512_shuffle_epi8(_mm512_shuffle_i64x2(u[l], u[l + 4], 0x88), order);
+                        words[8 * j + l + 4] = _mm512_shuffle_epi8(_mm512_shuffle_i64x2(u[l], u[l + 4], 0xDD), order);
+                    }
+                }
+
+                for (size_t i = 0; i < 8; ++i)
+                {
+                    s[i] = _mm512_loadu_si512((const void*)(state + 8 * i));
+                }
+
+                __m512i a = s[0], b = s[1], c = s[2], d = s[3];
+                __m512i e = s[4], f = s[5], g = s[6], h = s[7];
+
+                #define BOOP(x, y, z, table)\
+                    _mm512_ternarylogic_epi64(x, y, z, table)
+
+                for (size_t i = 0; i < 80; ++i)
+                {
+                    __m512i &w = words[i & 15];
+
+                    if (i >= 16)
+                    {
+                        const __m512i w15 = words[(i +  1) & 15];
+                        const __m512i w02 = words[(i + 14) & 15];
+
+                        w = _mm512_add_epi64(_mm512_add_epi64(w, words[(i + 9) & 15]), _mm512_add_epi64(
+                            BOOP(_mm512_ror_epi64(w15,  1), _mm512_ror_epi64(w15,  8), _mm512_srli_epi64(w15, 7), 150),
+                            BOOP(_mm512_ror_epi64(w02, 19), _mm512_ror_epi64(w02, 61), _mm512_srli_epi64(w02, 6), 150)));
+                    }
+
+                    const __m512i t1 = _mm512_add_epi64(
+                        _mm512_add_epi64(h, BOOP(_mm512_ror_epi64(e, 14), _mm512_ror_epi64(e, 18), _mm512_ror_epi64(e, 41), 150)),
+                        _mm512_add_epi64(BOOP(e, f, g, 202), _mm512_add_epi64(w, _mm512_set1_epi64((long long)salt[i]))));
+
+                    const __m512i t0 = _mm512_add_epi64(
+                        BOOP(_mm512_ror_epi64(a, 28), _mm512_ror_epi64(a, 34), _mm512_ror_epi64(a, 39), 150),
+                        BOOP(a, b, c, 232));
+
+                    h = g; g = f; f = e; e = _mm512_add_epi64(d, t1);
+                    d = c; c = b; b = a; a = _mm512_add_epi64(t1, t0);
+                }
+
+                #undef BOOP
+
+                s[0] = _mm512_add_epi64(s[0], a); s[1] = _mm512_add_epi64(s[1], b);
+                s[2] = _mm512_add_epi64(s[2], c); s[3] = _mm512_add_epi64(s[3], d);
+                s[4] = _mm512_add_epi64(s[4], e); s[5] = _mm512_add_epi64(s[5], f);
+                s[6] = _mm512_add_epi64(s[6], g); s[7] = _mm512_add_epi64(s[7], h);
+
+                for (size_t i = 0; i < 8; ++i)
+                {
+                    _mm512_storeu_si512((void*)(state + 8 * i), s[i]);
+                }
+            }
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,131 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Quasis (info@quasis.io)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+#include "crypto/hasher.h"
+
+namespace crypto
+{
+    namespace hasher
+    {
+        // sigma(), delta()
+
+
+        uint32_t
+        constexpr sigma0(const uint32_t &number)
+        {
+            return rotr(number, 7) ^ rotr(number,18) ^ (number >>  3);
+        }
+
+
+        uint64_t
+        constexpr sigma0(const uint64_t &number)
+        {
+            return rotr(number, 1) ^ rotr(number, 8) ^ (number >>  7);
+        }
+
+
+        uint32_t
+        constexpr sigma1(const uint32_t &number)
+        {
+            return rotr(number,17) ^ rotr(number,19) ^ (number >> 10);
+        }
+
+
+        uint64_t
+        constexpr sigma1(const uint64_t &number)
+        {
+            return rotr(number,19) ^ rotr(number,61) ^ (number >>  6);
+        }
+
+
+        uint32_t
+        constexpr delta0(const uint32_t &number)
+        {
+            return rotr(number, 2) ^ rotr(number,13) ^ rotr(number,22);
+        }
+
+
+        uint64_t
+        constexpr delta0(const uint64_t &number)
+        {
+            return rotr(number,28) ^ rotr(number,34) ^ rotr(number,39);
+        }
+
+
+        uint32_t
+        constexpr delta1(const uint32_t &number)
+        {
+            return rotr(number, 6) ^ rotr(number,11) ^ rotr(number,25);
+        }
+
+
+        uint64_t
+        constexpr delta1(const uint64_t &number)
+        {
+            return rotr(number,14) ^ rotr(number,18) ^ rotr(number,41);
+        }
+
+
+        // sha2round(), sha2rounds()
+        //
+        // The scalar SHA-2 rounds over a message schedule that already has the
+        // round constants folded in, as produced by the SIMD schedule kernels.
+        // sha2round() runs one round in place: callers rotate the names of the
+        // working variables instead of moving their values.
+
+
+        template<typename word_t> constexpr void
+        sha2round(const word_t &a, const word_t &b, const word_t &c, word_t &d,
+                  const word_t &e, const word_t &f, const word_t &g, word_t &h, const word_t &sched)
+        {
+            const word_t t1 = h + delta1(e) + boop202(e, f, g) + sched;
+            d += t1; h = t1 + delta0(a) + boop232(a, b, c);
+        }
+
+
+        template<typename word_t> void
+        inline sha2rounds(word_t *hash, const word_t *sched, const size_t &count)
+        {
+            word_t a = hash[0], b = hash[1], c = hash[2], d = hash[3];
+            word_t e = hash[4], f = hash[5], g = hash[6], h = hash[7];
+
+            for (size_t i = 0; i < count; i += 8)
+            {
+                sha2round(a, b, c, d, e, f, g, h, sched[i + 0]);
+                sha2round(h, a, b, c, d, e, f, g, sched[i + 1]);
+                sha2round(g, h, a, b, c, d, e, f, sched[i + 2]);
+                sha2round(f, g, h, a, b, c, d, e, sched[i + 3]);
+                sha2round(e, f, g, h, a, b, c, d, sched[i + 4]);
+                sha2round(d, e, f, g, h, a, b, c, sched[i + 5]);
+                sha2round(c, d, e, f, g, h, a, b, sched[i + 6]);
+                sha2round(b, c, d, e, f, g, h, a, sched[i + 7]);
+            }
+
+            hash[0] += a; hash[1] += b; hash[2] += c; hash[3] += d;
+            hash[4] += e; hash[5] += f; hash[6] += g; hash[7] += h;
+        }
+    }
+}
@@ -0,0 +1,112 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Quasis (info@quasis.io)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+#include "crypto/cpu.h"
+
+#if defined(CRYPTO_X86)
+
+namespace crypto
+{
+    namespace hasher
+    {
+        // sha256ni()
+        //
+        // SHA-256 compression on the x86 SHA extensions. The state is kept in
+        // the ABEF/CDGH register layout expected by sha256rnds2 and converted
+        // back to the plain a..h order on exit; the salt is the SHA-256 round
+        // constant table.
+
+
+        CRYPTO_TARGET("sha,sse4.1,ssse3") inline void
+        sha256ni(uint32_t *hash, const uint32_t *salt, const uint8_t *block, size_t count)
+        {
+            const __m128i order = _mm_set_epi64x(0x0C0D0E0F08090A0BULL, 0x0405060700010203ULL);
+
+            __m128i buffer = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(hash + 0)), 0xB1);
+            __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(hash + 4)), 0x1B);
+            __m128i state0 = _mm_alignr_epi8(buffer, state1, 8);
+                    state1 = _mm_blend_epi16(state1, buffer, 0xF0);
+
+            #define LOAD(m, i)\
+                m = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(block + 16 * i)), order);
+
+            #define QUAD(m, i)\
+            {\
+                buffer = _mm_add_epi32(m, _mm_loadu_si128((const __m128i*)(salt + 4 * i)));\
+                state1 = _mm_sha256rnds2_epu32(state1, state0, buffer);\
+                state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(buffer, 0x0E));\
+            }
+
+            #define NEXT(n, m, p)\
+                n = _mm_sha256msg2_epu32(_mm_add_epi32(n, _mm_alignr_epi8(m, p, 4)), m);
+
+            #define PREP(p, m)\
+                p = _mm_sha256msg1_epu32(p, m);
+
+            for (; count; --count, block += 64)
+            {
+                const __m128i abef = state0;
+                const __m128i cdgh = state1;
+                __m128i m0, m1, m2, m3;
+
+                LOAD(m0,  0); QUAD(m0,  0);
+                LOAD(m1,  1); QUAD(m1,  1);                     PREP(m0, m1);
+                LOAD(m2,  2); QUAD(m2,  2);                     PREP(m1, m2);
+                LOAD(m3,  3); QUAD(m3,  3); NEXT(m0, m3, m2);   PREP(m2, m3);
+                              QUAD(m0,  4); NEXT(m1, m0, m3);   PREP(m3, m0);
+                              QUAD(m1,  5); NEXT(m2, m1, m0);   PREP(m0, m1);
+                              QUAD(m2,  6); NEXT(m3, m2, m1);   PREP(m1, m2);
+                              QUAD(m3,  7); NEXT(m0, m3, m2);   PREP(m2, m3);
+                              QUAD(m0,  8); NEXT(m1, m0, m3);   PREP(m3, m0);
+                              QUAD(m1,  9); NEXT(m2, m1, m0);   PREP(m0, m1);
+                              QUAD(m2, 10); NEXT(m3, m2, m1);   PREP(m1, m2);
+                              QUAD(m3, 11); NEXT(m0, m3, m2);   PREP(m2, m3);
+                              QUAD(m0, 12); NEXT(m1, m0, m3);   PREP(m3, m0);
+                              QUAD(m1, 13); NEXT(m2, m1, m0);
+                              QUAD(m2, 14); NEXT(m3, m2, m1);
+                              QUAD(m3, 15);
+
+                state0 = _mm_add_epi32(state0, abef);
+                state1 = _mm_add_epi32(state1, cdgh);
+            }
+
+            #undef PREP
+            #undef NEXT
+            #undef QUAD
+            #undef LOAD
+
+            buffer = _mm_shuffle_epi32(state0, 0x1B);
+            state1 = _mm_shuffle_epi32(state1, 0xB1);
+            state0 = _mm_blend_epi16(buffer, state1, 0xF0);
+            state1 = _mm_alignr_epi8(state1, buffer, 8);
+
+            _mm_storeu_si128((__m128i*)(hash + 0), state0);
+            _mm_storeu_si128((__m128i*)(hash + 4), state1);
+        }
+    }
+}
+
+#endif
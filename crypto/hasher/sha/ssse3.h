@@ -0,0 +1,174 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Quasis (info@quasis.io)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+#include "crypto/cpu.h"
+#include "crypto/hasher/sha/rounds.h"
+
+#if defined(CRYPTO_X86)
+
+namespace crypto
+{
+    namespace hasher
+    {
+        // sha256ssse3()
+        //
+        // SHA-256 compression for processors without the SHA extensions. The
+        // message schedule is expanded four words at a time in SSE registers,
+        // interleaved with the scalar rounds that consume the previous four.
+        // The sigma1 term reads the two words computed just before, so each
+        // step adds it in two halves.
+
+
+        CRYPTO_TARGET("ssse3") inline void
+        sha256ssse3(uint32_t *hash, const uint32_t *salt, const uint8_t *block, size_t count)
+        {
+            const __m128i order = _mm_set_epi64x(0x0C0D0E0F08090A0BULL, 0x0405060700010203ULL);
+
+            #define ROTR(x, n)\
+                _mm_or_si128(_mm_srli_epi32(x, n), _mm_slli_epi32(x, 32 - n))
+
+            #define SIGMA0(x)\
+                _mm_xor_si128(_mm_xor_si128(ROTR(x,  7), ROTR(x, 18)), _mm_srli_epi32(x,  3))
+
+            #define SIGMA1(x)\
+                _mm_xor_si128(_mm_xor_si128(ROTR(x, 17), ROTR(x, 19)), _mm_srli_epi32(x, 10))
+
+            #define QUAD(a, b, c, d, e, f, g, h, i)\
+            {\
+                _mm_storeu_si128((__m128i*)sched, _mm_add_epi32(x0, _mm_loadu_si128((const __m128i*)(salt + i))));\
+                __m128i w = x0;\
+                if (i < 48)\
+                {\
+                    w = _mm_add_epi32(_mm_add_epi32(x0, SIGMA0(_mm_alignr_epi8(x1, x0, 4))), _mm_alignr_epi8(x3, x2, 4));\
+                    w = _mm_add_epi32(w, _mm_srli_si128(SIGMA1(x3), 8));\
+                    w = _mm_add_epi32(w, _mm_slli_si128(SIGMA1(w ), 8));\
+                }\
+                sha2round(a, b, c, d, e, f, g, h, sched[0]);\
+                sha2round(h, a, b, c, d, e, f, g, sched[1]);\
+                sha2round(g, h, a, b, c, d, e, f, sched[2]);\
+                sha2round(f, g, h, a, b, c, d, e, sched[3]);\
+                x0 = x1; x1 = x2; x2 = x3; x3 = w;\
+            }
+
+            uint32_t sched[4];
+
+            for (; count; --count, block += 64)
+            {
+                uint32_t a = hash[0], b = hash[1], c = hash[2], d = hash[3];
+                uint32_t e = hash[4], f = hash[5], g = hash[6], h = hash[7];
+
+                __m128i x0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(block +  0)), order);
+                __m128i x1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(block + 16)), order);
+                __m128i x2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(block + 32)), order);
+                __m128i x3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(block + 48)), order);
+
+                for (size_t i = 0; i < 64; i += 8)
+                {
+                    QUAD(a, b, c, d, e, f, g, h, i + 0);
+                    QUAD(e, f, g, h, a, b, c, d, i + 4);
+                }
+
+                hash[0] += a; hash[1] += b; hash[2] += c; hash[3] += d;
+                hash[4] += e; hash[5] += f; hash[6] += g; hash[7] += h;
+            }
+
+            #undef QUAD
+            #undef SIGMA1
+            #undef SIGMA0
+            #undef ROTR
+        }
+
+
+        // sha512ssse3()
+        //
+        // SHA-512 compression with the message schedule expanded two words at
+        // a time; at that width sigma1 only reads the previous register.
+
+
+        CRYPTO_TARGET("ssse3") inline void
+        sha512ssse3(uint64_t *hash, const uint64_t *salt, const uint8_t *block, size_t count)
+        {
+            const __m128i order = _mm_set_epi64x(0x08090A0B0C0D0E0FULL, 0x0001020304050607ULL);
+
+            #define ROTR(x, n)\
+                _mm_or_si128(_mm_srli_epi64(x, n), _mm_slli_epi64(x, 64 - n))
+
+            #define SIGMA0(x)\
+                _mm_xor_si128(_mm_xor_si128(ROTR(x,  1), ROTR(x,  8)), _mm_srli_epi64(x, 7))
+
+            #define SIGMA1(x)\
+                _mm_xor_si128(_mm_xor_si128(ROTR(x, 19), ROTR(x, 61)), _mm_srli_epi64(x, 6))
+
+            #define PAIR(a, b, c, d, e, f, g, h, i)\
+            {\
+                _mm_storeu_si128((__m128i*)sched, _mm_add_epi64(x[0], _mm_loadu_si128((const __m128i*)(salt + i))));\
+                __m128i w = x[0];\
+                if (i < 64)\
+                {\
+                    w = _mm_add_epi64(_mm_add_epi64(x[0], SIGMA0(_mm_alignr_epi8(x[1], x[0], 8))),\
+                                      _mm_add_epi64(_mm_alignr_epi8(x[5], x[4], 8), SIGMA1(x[7])));\
+                }\
+                sha2round(a, b, c, d, e, f, g, h, sched[0]);\
+                sha2round(h, a, b, c, d, e, f, g, sched[1]);\
+                x[0] = x[1]; x[1] = x[2]; x[2] = x[3]; x[3] = x[4];\
+                x[4] = x[5]; x[5] = x[6]; x[6] = x[7]; x[7] = w;\
+            }
+
+            uint64_t sched[2];
+
+            for (; count; --count, block += 128)
+            {
+                uint64_t a = hash[0], b = hash[1], c = hash[2], d = hash[3];
+                uint64_t e = hash[4], f = hash[5], g = hash[6], h = hash[7];
+
+                __m128i x[8];
+
+                for (size_t i = 0; i < 8; ++i)
+                {
+                    x[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(block + 16 * i)), order);
+                }
+
+                for (size_t i = 0; i < 80; i += 8)
+                {
+                    PAIR(a, b, c, d, e, f, g, h, i + 0);
+                    PAIR(g, h, a, b, c, d, e, f, i + 2);
+                    PAIR(e, f, g, h, a, b, c, d, i + 4);
+                    PAIR(c, d, e, f, g, h, a, b, i + 6);
+                }
+
+                hash[0] += a; hash[1] += b; hash[2] += c; hash[3] += d;
+                hash[4] += e; hash[5] += f; hash[6] += g; hash[7] += h;
+            }
+
+            #undef PAIR
+            #undef SIGMA1
+            #undef SIGMA0
+            #undef ROTR
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,231 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Quasis (info@quasis.io)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+#include <memory>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include "crypto/pool.h"
+#include "crypto/hasher/sha.h"
+
+namespace crypto
+{
+    namespace hasher
+    {
+        // Tree<BITS, VITS> hashes a message as a binary tree of SHA<BITS, VITS>
+        // digests, so chunks can be hashed on every thread at once:
+        //
+        //   the message is cut into chunks of C bytes, the last one shorter;
+        //   an empty message is a single empty chunk
+        //
+        //   leaf  = H(0x00 || chunk)
+        //   node  = H(0x01 || left || right)
+        //   top   = the tree of RFC 6962 over the leaves, i.e. the left
+        //           subtree of n > 1 leaves holds the largest power of two
+        //           below n
+        //   root  = H(0x02 || le64(C) || le64(length) || top)
+        //
+        // The digest depends on C but not on the number of threads. Updates
+        // are buffered until a batch holds one chunk per thread; batches
+        // straight from the caller's memory are not copied. Finished subtrees
+        // are merged on a stack as soon as they have equal height, so memory
+        // stays at one batch plus one digest per level
+
+        template<size_t BITS, size_t VITS = BITS>
+        class Tree : public Hasher<VITS, VITS, Tree<BITS, VITS>>
+        {
+            friend class Hasher<VITS, VITS, Tree>;
+
+            typedef typename Hasher<VITS, VITS, Tree>::byte_t byte_t;
+            typedef SHA<BITS, VITS>                            core_t;
+            typedef std::pair<Number<VITS>, size_t>            part_t;
+
+            size_t                     m_chunk;
+            size_t                     m_batch;
+            Pool                      &m_pool;
+            std::unique_ptr<byte_t[]>  m_data;
+            std::vector<Number<VITS>>  m_leaves;
+            std::vector<part_t>        m_stack;
+            Number<VITS>               m_root;
+
+
+        public:
+
+            enum : size_t
+            {
+                CHUNK = 1 << 20,
+            };
+
+
+            Tree(const size_t &chunk = CHUNK, Pool &pool = Pool::shared())
+                : m_chunk{ chunk }, m_batch{ pool.size() }, m_pool(pool), m_data{ new byte_t[chunk * pool.size()] }, m_leaves(pool.size())
+            {
+                assert(chunk > 0);
+            }
+
+
+            Tree(const Tree&) = delete;
+            Tree& operator=(const Tree&) = delete;
+
+
+           ~Tree()
+            {
+                memset(this->data(), 0, this->capacity());
+            }
+
+
+            const byte_t*
+            hash() const
+            {
+                return this->m_root.data();
+            }
+
+
+            byte_t*
+            data()
+            {
+                return this->m_data.get();
+            }
+
+
+            const byte_t*
+            data() const
+            {
+                return this->m_data.get();
+            }
+
+
+            size_t
+            capacity() const
+            {
+                return this->m_chunk * this->m_batch;
+            }
+
+
+            static Number<VITS>
+            node(const Number<VITS> &left, const Number<VITS> &right)
+            {
+                const uint8_t prefix = 0x01;
+                return core_t().update({ { &prefix, 1 }, { left.data(), left.size() }, { right.data(), right.size() } }).digest();
+            }
+
+
+        protected:
+
+            // chunks() hashes count chunks of one batch in parallel and
+            // pushes the leaves in order; the last chunk may be shorter
+
+            void
+            chunks(const byte_t *block, const size_t &count, const size_t &length)
+            {
+                this->m_pool.run(count, 1, [&](size_t begin, size_t end)
+                {
+                    const uint8_t prefix = 0x00;
+
+                    for (size_t i = begin; i < end; ++i)
+                    {
+                        const size_t volume = std::min(this->m_chunk, length - i * this->m_chunk);
+                        this->m_leaves[i] = core_t().update({ { &prefix, 1 }, { block + i * this->m_chunk, volume } }).digest();
+                    }
+                });
+
+                for (size_t i = 0; i < count; ++i)
+                {
+                    this->push(this->m_leaves[i]);
+                }
+            }
+
+
+            void
+            push(const Number<VITS> &leaf)
+            {
+                this->m_stack.emplace_back(leaf, 0);
+
+                for (size_t n; (n = this->m_stack.size()) > 1 && this->m_stack[n - 2].second == this->m_stack[n - 1].second;)
+                {
+                    this->m_stack[n - 2].first = node(this->m_stack[n - 2].first, this->m_stack[n - 1].first);
+                    this->m_stack[n - 2].second++;
+                    this->m_stack.pop_back();
+                }
+            }
+
+
+            void
+            compress(const byte_t *block, size_t count)
+            {
+                for (; count; --count, block += this->capacity())
+                {
+                    this->chunks(block, this->m_batch, this->capacity());
+                }
+            }
+
+
+            void
+            initialize()
+            {
+                this->m_stack.clear();
+            }
+
+
+            void
+            finalize()
+            {
+                const size_t tail = size_t(this->end() - this->data());
+
+                if (tail || this->size() == 0)
+                {
+                    this->chunks(this->data(), std::max((tail + this->m_chunk - 1) / this->m_chunk, size_t(1)), tail);
+                }
+
+                Number<VITS> top = this->m_stack.back().first;
+
+                for (size_t i = this->m_stack.size() - 1; i--;)
+                {
+                    top = node(this->m_stack[i].first, top);
+                }
+
+                uint8_t header[17] = { 0x02 };
+
+                for (size_t i = 0; i < 8; ++i)
+                {
+                    header[1 + i] = uint8_t(uint64_t(this->m_chunk) >> (8 * i));
+                    header[9 + i] = uint8_t(uint64_t(this->size()) >> (8 * i));
+                }
+
+                this->m_root = core_t().update({ { header, sizeof(header) }, { top.data(), top.size() } }).digest();
+                this->m_stack.clear();
+                memset(this->data(), 0, tail);
+            }
+        };
+    }
+
+
+    template<size_t BITS, size_t VITS = BITS> auto
+    tree(const void *record, const size_t &length, const size_t &chunk = hasher::Tree<BITS, VITS>::CHUNK)
+    {
+        return hasher::Tree<BITS, VITS>(chunk).update(record, length).digest();
+    }
+}
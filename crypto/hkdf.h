@@ -0,0 +1,162 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Quasis (info@quasis.io)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+#include <vector>
+#include <algorithm>
+#include "crypto/hasher/hmac.h"
+
+namespace crypto
+{
+    // HKDF<BITS, VITS> is the extract-and-expand key derivation of RFC 5869
+    // over HMAC<BITS, VITS>. The key schedule of the pseudorandom key is
+    // computed once by the constructor and serves every block of every
+    // expand(), so a block costs its message blocks plus one outer block
+
+    template<size_t BITS, size_t VITS = BITS>
+    class HKDF
+    {
+        typedef hasher::HMAC<BITS, VITS> hmac_t;
+        typedef typename hmac_t::Key     key_t;
+        typedef uint8_t                  byte_t;
+
+        static constexpr size_t DIGEST = VITS / CHAR_BIT;
+
+        key_t m_prk;
+
+
+    public:
+
+        enum : size_t
+        {
+            LIMIT = 255 * DIGEST,
+        };
+
+
+        // extract() returns the pseudorandom key; an empty salt acts as a
+        // digest of zeros, since HMAC pads short keys with zeros anyway
+
+        static Number<VITS>
+        extract(const void *salt, const size_t &length, const void *secret, const size_t &size)
+        {
+            return hmac_t::oneshot(key_t(salt, length), secret, size);
+        }
+
+
+        HKDF(const void *salt, const size_t &length, const void *secret, const size_t &size)
+            : m_prk(extract(salt, length, secret, size).data(), DIGEST)
+        {
+        }
+
+
+        // a pseudorandom key from elsewhere skips the extract step
+
+        explicit HKDF(const Number<VITS> &prk) : m_prk(prk.data(), DIGEST)
+        {
+        }
+
+
+        // expand() fills volume bytes for one info label and returns false
+        // past LIMIT bytes, as RFC 5869 requires
+
+        bool
+        expand(const void *info, const size_t &length, void *output, const size_t &volume) const
+        {
+            hmac_t       mac(this->m_prk);
+            Number<VITS> block;
+
+            if (volume > LIMIT)
+            {
+                return false;
+            }
+
+            for (size_t b = 0; b * DIGEST < volume; ++b)
+            {
+                const byte_t counter = byte_t(b + 1);
+
+                mac.reset().update({ { block.data(), b ? DIGEST : 0 }, { info, length }, { &counter, 1 } }).digest(block.data());
+                memcpy((byte_t*)output + b * DIGEST, block.data(), std::min(DIGEST, volume - b * DIGEST));
+            }
+
+            return true;
+        }
+
+
+        // expand() of a batch fills volume bytes for each of count labels,
+        // one after another in output. Block i of every label is hashed in
+        // one HMAC batch, so short labels go through the SIMD lanes together
+
+        bool
+        expand(const Slice *infos, void *output, const size_t &volume, const size_t &count) const
+        {
+            const size_t              blocks = (volume + DIGEST - 1) / DIGEST;
+            std::vector<key_t>        keys(count, this->m_prk);
+            std::vector<String<>>     messages(count);
+            std::vector<Slice>        slices(count);
+            std::vector<Number<VITS>> digests(count);
+
+            if (volume > LIMIT)
+            {
+                return false;
+            }
+
+            for (size_t b = 0; b < blocks; ++b)
+            {
+                for (size_t i = 0; i < count; ++i)
+                {
+                    String<> &message = messages[i];
+
+                    message.assign((const char*)digests[i].data(), b ? DIGEST : 0);
+                    message.append((const char*)infos[i].record, infos[i].length);
+                    message.push_back(char(b + 1));
+
+                    slices[i] = { message.data(), message.size() };
+                }
+
+                hmac_t::batch(keys.data(), slices.data(), digests.data(), count);
+
+                for (size_t i = 0; i < count; ++i)
+                {
+                    memcpy((byte_t*)output + i * volume + b * DIGEST, digests[i].data(), std::min(DIGEST, volume - b * DIGEST));
+                }
+            }
+
+            for (String<> &message : messages)
+            {
+                memset(&message[0], 0, message.size());
+            }
+
+            return true;
+        }
+    };
+
+
+    template<size_t BITS, size_t VITS = BITS> bool
+    hkdf(const void *salt, const size_t &length, const void *secret, const size_t &size,
+         const void *info, const size_t &labels, void *output, const size_t &volume)
+    {
+        return HKDF<BITS, VITS>(salt, length, secret, size).expand(info, labels, output, volume);
+    }
+}
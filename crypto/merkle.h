@@ -0,0 +1,297 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Quasis (info@quasis.io)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+#include <vector>
+#include <algorithm>
+#include "crypto/pool.h"
+#include "crypto/hasher/fused.h"
+
+namespace crypto
+{
+    namespace merkle
+    {
+        // Bitcoin hashes leaves and pairs of nodes with sha256d() and pairs
+        // the last node of an odd level with a copy of itself
+
+        struct Bitcoin
+        {
+            static constexpr bool DUPLICATE = true;
+
+
+            static Number<256>
+            empty()
+            {
+                return Number<256>();
+            }
+
+
+            static void
+            leaves(const Slice *slices, Number<256> *digests, const size_t &count)
+            {
+                sha256d(slices, digests, count);
+            }
+
+
+            // nodes() hashes count pairs of adjacent nodes, each pair being
+            // one 64-byte message, 64 messages per batch
+
+            static void
+            nodes(const Number<256> *pairs, Number<256> *digests, const size_t &count)
+            {
+                Slice slices[64];
+
+                for (size_t i = 0, n; i < count; i += n)
+                {
+                    n = std::min(count - i, size_t(64));
+
+                    for (size_t j = 0; j < n; ++j)
+                    {
+                        slices[j] = { pairs[2 * (i + j)].data(), 2 * pairs->size() };
+                    }
+
+                    sha256d(slices, digests + i, n);
+                }
+            }
+        };
+
+
+        // RFC6962 hashes leaves as sha<256>(0x00 || leaf) and nodes as
+        // sha<256>(0x01 || left || right). The last node of an odd level is
+        // carried up unchanged, which gives the same tree as the recursive
+        // split at the largest power of two in RFC 6962
+
+        struct RFC6962
+        {
+            static constexpr bool DUPLICATE = false;
+
+
+            static Number<256>
+            empty()
+            {
+                return sha<256>("", 0);
+            }
+
+
+            static void
+            leaves(const Slice *slices, Number<256> *digests, const size_t &count)
+            {
+                const uint8_t prefix = 0x00;
+
+                for (size_t i = 0; i < count; ++i)
+                {
+                    digests[i] = hasher::SHA<256>().update({ { &prefix, 1 }, slices[i] }).digest();
+                }
+            }
+
+
+            static void
+            nodes(const Number<256> *pairs, Number<256> *digests, const size_t &count)
+            {
+                uint8_t block[64][65];
+                Slice   slices[64];
+
+                for (size_t i = 0, n; i < count; i += n)
+                {
+                    n = std::min(count - i, size_t(64));
+
+                    for (size_t j = 0; j < n; ++j)
+                    {
+                        block[j][0] = 0x01;
+                        memcpy(block[j] + 1, pairs[2 * (i + j)].data(), 64);
+                        slices[j] = { block[j], sizeof(block[j]) };
+                    }
+
+                    sha<256>(slices, digests + i, n);
+                }
+            }
+        };
+    }
+
+
+    // Merkle<scheme_t> keeps every level of the tree, leaf hashes first, so
+    // proofs are read off without rehashing. Each level is hashed from the
+    // one below in chunks of GRAIN pairs spread over a thread pool, and every
+    // chunk goes through the batch hashers 64 pairs at a time
+
+    template<class scheme_t = merkle::Bitcoin>
+    class Merkle
+    {
+        enum : size_t
+        {
+            GRAIN = 1024,
+        };
+
+        std::vector<std::vector<Number<256>>> m_levels;
+
+
+        void
+        build(Pool &pool)
+        {
+            while (this->m_levels.back().size() > 1)
+            {
+                const std::vector<Number<256>> &below = this->m_levels.back();
+                std::vector<Number<256>>        above((below.size() + 1) / 2);
+
+                pool.run(below.size() / 2, GRAIN, [&](size_t begin, size_t end)
+                {
+                    scheme_t::nodes(below.data() + 2 * begin, above.data() + begin, end - begin);
+                });
+
+                if (below.size() % 2)
+                {
+                    above.back() = scheme_t::DUPLICATE ? node(below.back(), below.back()) : below.back();
+                }
+
+                this->m_levels.push_back(std::move(above));
+            }
+        }
+
+
+    public:
+
+        // the leaves are hashed as the scheme requires
+
+        Merkle(const Slice *leaves, const size_t &count, Pool &pool = Pool::shared()) : m_levels(1)
+        {
+            this->m_levels[0].resize(count);
+
+            pool.run(count, GRAIN, [&](size_t begin, size_t end)
+            {
+                scheme_t::leaves(leaves + begin, this->m_levels[0].data() + begin, end - begin);
+            });
+
+            this->build(pool);
+        }
+
+
+        // the leaves are already hashed, e.g. transaction ids
+
+        Merkle(const Number<256> *hashes, const size_t &count, Pool &pool = Pool::shared()) : m_levels(1)
+        {
+            this->m_levels[0].assign(hashes, hashes + count);
+            this->build(pool);
+        }
+
+
+        size_t
+        size() const
+        {
+            return this->m_levels[0].size();
+        }
+
+
+        Number<256>
+        root() const
+        {
+            return this->size() ? this->m_levels.back()[0] : scheme_t::empty();
+        }
+
+
+        // proof() lists the siblings on the way from a leaf to the root,
+        // bottom up. Bitcoin proofs repeat a node paired with itself; RFC
+        // 6962 proofs skip the levels a node is carried up unchanged
+
+        std::vector<Number<256>>
+        proof(const size_t &index) const
+        {
+            std::vector<Number<256>> path;
+
+            if (index >= this->size())
+            {
+                return path;
+            }
+
+            for (size_t level = 0, i = index; level + 1 < this->m_levels.size(); ++level, i >>= 1)
+            {
+                const std::vector<Number<256>> &nodes = this->m_levels[level];
+
+                if ((i ^ 1) < nodes.size())
+                {
+                    path.push_back(nodes[i ^ 1]);
+                }
+                else if (scheme_t::DUPLICATE)
+                {
+                    path.push_back(nodes[i]);
+                }
+            }
+
+            return path;
+        }
+
+
+        static Number<256>
+        leaf(const void *record, const size_t &length)
+        {
+            const Slice slice{ record, length };
+            Number<256> digest;
+
+            return scheme_t::leaves(&slice, &digest, 1), digest;
+        }
+
+
+        static Number<256>
+        node(const Number<256> &left, const Number<256> &right)
+        {
+            const Number<256> pair[2] = { left, right };
+            Number<256>       digest;
+
+            return scheme_t::nodes(pair, &digest, 1), digest;
+        }
+
+
+        // verify() folds a proof into the leaf hash and compares the result
+        // with the root; the leaf count tells which levels carry the node up
+
+        static bool
+        verify(Number<256> hash, const size_t &index, const size_t &count, const std::vector<Number<256>> &path, const Number<256> &root)
+        {
+            size_t k = 0;
+
+            if (index >= count)
+            {
+                return false;
+            }
+
+            for (size_t i = index, last = count - 1; last; i >>= 1, last >>= 1)
+            {
+                if (!scheme_t::DUPLICATE && i == last && i % 2 == 0)
+                {
+                    continue;
+                }
+
+                if (k == path.size())
+                {
+                    return false;
+                }
+
+                hash = i % 2 ? node(path[k], hash) : node(hash, path[k]);
+                ++k;
+            }
+
+            return k == path.size() && hash == root;
+        }
+    };
+}
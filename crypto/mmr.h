@@ -0,0 +1,625 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Quasis (info@quasis.io)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include "crypto/hasher/sha.h"
+
+#if defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+namespace crypto
+{
+    namespace mmr
+    {
+        // an MMR of n leaves is a row of perfect trees, one per set bit of n
+        // from the highest down, stored in post-order: every node follows its
+        // children. leaves() gives n for a number of nodes, or SIZE_MAX when
+        // no leaf count gives that many
+
+        constexpr size_t
+        leaves(size_t nodes)
+        {
+            size_t count = 0;
+
+            for (size_t h = sizeof(size_t) * CHAR_BIT - 1; h--;)
+            {
+                if (nodes >= (size_t(2) << h) - 1)
+                {
+                    nodes -= (size_t(2) << h) - 1;
+                    count += size_t(1) << h;
+                }
+            }
+
+            return nodes ? SIZE_MAX : count;
+        }
+
+
+        // an inclusion proof: the siblings from the leaf up to its peak,
+        // bottom up, and every peak of the range it was taken from
+
+        struct Proof
+        {
+            std::vector<Number<256>> path;
+            std::vector<Number<256>> peaks;
+        };
+
+
+        // a node store holds the nodes in post-order: reserve() makes room
+        // for the nodes of one append, push() adds one, and commit() makes
+        // the nodes pushed so far count as a whole, so an append interrupted
+        // between two commits is rolled back on reopen
+
+        class Memory
+        {
+            std::vector<Number<256>> m_nodes;
+
+
+        public:
+
+            size_t
+            size() const
+            {
+                return this->m_nodes.size();
+            }
+
+
+            const Number<256>&
+            operator[](const size_t &offset) const
+            {
+                return this->m_nodes[offset];
+            }
+
+
+            bool
+            reserve(const size_t&)
+            {
+                return true;
+            }
+
+
+            void
+            push(const Number<256> &node)
+            {
+                this->m_nodes.push_back(node);
+            }
+
+
+            void
+            commit()
+            {
+            }
+        };
+
+
+        // Mapped keeps the nodes in a memory-mapped file: a 32-byte header
+        // with the magic "QMMR", a version byte and the committed node count
+        // (le64), then 32 bytes per node. The mapping doubles as it fills;
+        // reopening a file resumes the range without rehashing anything.
+        // Check valid() after construction: a file that cannot be opened or
+        // mapped, or whose header does not match, leaves the store invalid
+
+        class Mapped
+        {
+            enum : size_t
+            {
+                HEADER  = 32,
+                VERSION =  1,
+                INITIAL = 1024,
+            };
+
+            #if defined(_WIN32)
+                HANDLE  m_file;
+                HANDLE  m_mapping;
+            #else
+                int     m_file;
+            #endif
+
+            uint8_t    *m_memory;
+            size_t      m_count;
+            size_t      m_capacity;
+
+
+            // map() maps the file at a new capacity and drops the old view
+            // only once the new one exists, so a failed grow leaves the store
+            // as it was
+
+            bool
+            map(const size_t &capacity)
+            {
+                const size_t volume = HEADER + capacity * sizeof(Number<256>);
+                uint8_t     *memory = nullptr;
+
+                #if defined(_WIN32)
+                    HANDLE mapping = CreateFileMappingA(this->m_file, nullptr, PAGE_READWRITE, DWORD(uint64_t(volume) >> 32), DWORD(volume), nullptr);
+
+                    if (mapping)
+                    {
+                        memory = (uint8_t*)MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, volume);
+
+                        if (!memory)
+                        {
+                            CloseHandle(mapping);
+                            return false;
+                        }
+                    }
+                #else
+                    if (ftruncate(this->m_file, off_t(volume)) == 0)
+                    {
+                        void *view = mmap(nullptr, volume, PROT_READ | PROT_WRITE, MAP_SHARED, this->m_file, 0);
+                        memory = view == MAP_FAILED ? nullptr : (uint8_t*)view;
+                    }
+
+                    // a file grown for a view that failed gets its old size back
+
+                    if (!memory && this->m_memory && ftruncate(this->m_file, off_t(HEADER + this->m_capacity * sizeof(Number<256>))) != 0)
+                    {
+                        return false;
+                    }
+                #endif
+
+                if (!memory)
+                {
+                    return false;
+                }
+
+                this->unmap();
+
+                #if defined(_WIN32)
+                    this->m_mapping = mapping;
+                #endif
+
+                this->m_memory   = memory;
+                this->m_capacity = capacity;
+                return true;
+            }
+
+
+            void
+            unmap()
+            {
+                #if defined(_WIN32)
+                    if (this->m_memory)   UnmapViewOfFile(this->m_memory);
+                    if (this->m_mapping)  CloseHandle(this->m_mapping);
+                    this->m_mapping = nullptr;
+                #else
+                    if (this->m_memory)   munmap(this->m_memory, HEADER + this->m_capacity * sizeof(Number<256>));
+                #endif
+
+                this->m_memory   = nullptr;
+                this->m_capacity = 0;
+            }
+
+
+        public:
+
+            explicit Mapped(const char *path) : m_memory{ nullptr }, m_count{ 0 }, m_capacity{ 0 }
+            {
+                uint64_t volume = 0;
+
+                #if defined(_WIN32)
+                    LARGE_INTEGER length{};
+
+                    this->m_mapping = nullptr;
+                    this->m_file    = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+                    if (this->m_file == INVALID_HANDLE_VALUE || !GetFileSizeEx(this->m_file, &length))
+                    {
+                        return;
+                    }
+
+                    volume = uint64_t(length.QuadPart);
+                #else
+                    struct stat status{};
+
+                    this->m_file = open(path, O_RDWR | O_CREAT, 0644);
+
+                    if (this->m_file < 0 || fstat(this->m_file, &status) != 0)
+                    {
+                        return;
+                    }
+
+                    volume = uint64_t(status.st_size);
+                #endif
+
+                if (volume == 0)
+                {
+                    if (this->map(INITIAL))
+                    {
+                        memcpy(this->m_memory, "QMMR", 4);
+                        this->m_memory[4] = VERSION;
+                    }
+
+                    return;
+                }
+
+                if (volume < HEADER || !this->map((std::max)(size_t((volume - HEADER) / sizeof(Number<256>)), size_t(INITIAL))))
+                {
+                    return;
+                }
+
+                for (size_t i = 0; i < 8; ++i)
+                {
+                    this->m_count |= size_t(this->m_memory[8 + i]) << (8 * i);
+                }
+
+                if (memcmp(this->m_memory, "QMMR", 4) || this->m_memory[4] != VERSION ||
+                    this->m_count > this->m_capacity || leaves(this->m_count) == SIZE_MAX)
+                {
+                    this->m_count = 0;
+                    this->unmap();
+                }
+            }
+
+
+            Mapped(const Mapped&) = delete;
+            Mapped& operator=(const Mapped&) = delete;
+
+
+           ~Mapped()
+            {
+                this->sync();
+                this->unmap();
+
+                #if defined(_WIN32)
+                    if (this->m_file != INVALID_HANDLE_VALUE) CloseHandle(this->m_file);
+                #else
+                    if (this->m_file >= 0) close(this->m_file);
+                #endif
+            }
+
+
+            bool
+            valid() const
+            {
+                return this->m_memory != nullptr;
+            }
+
+
+            size_t
+            size() const
+            {
+                return this->m_memory ? this->m_count : 0;
+            }
+
+
+            const Number<256>&
+            operator[](const size_t &offset) const
+            {
+                return ((const Number<256>*)(this->m_memory + HEADER))[offset];
+            }
+
+
+            // reserve() may remap the file, which invalidates references
+            // returned by operator[]; it fails when the file cannot grow,
+            // and the nodes stored so far stay readable
+
+            bool
+            reserve(const size_t &count)
+            {
+                size_t capacity = this->m_capacity;
+
+                if (!this->m_memory || count > (SIZE_MAX - HEADER) / sizeof(Number<256>))
+                {
+                    return false;
+                }
+
+                while (capacity < count)
+                {
+                    capacity *= 2;
+                }
+
+                return capacity == this->m_capacity || this->map(capacity);
+            }
+
+
+            void
+            push(const Number<256> &node)
+            {
+                memcpy(this->m_memory + HEADER + this->m_count++ * sizeof(Number<256>), node.data(), node.size());
+            }
+
+
+            void
+            commit()
+            {
+                for (size_t i = 0; i < 8 && this->m_memory; ++i)
+                {
+                    this->m_memory[8 + i] = uint8_t(uint64_t(this->m_count) >> (8 * i));
+                }
+            }
+
+
+            // sync() flushes the mapping to disk
+
+            void
+            sync()
+            {
+                if (this->m_memory)
+                {
+                    #if defined(_WIN32)
+                        FlushViewOfFile(this->m_memory, 0);
+                        FlushFileBuffers(this->m_file);
+                    #else
+                        msync(this->m_memory, HEADER + this->m_capacity * sizeof(Number<256>), MS_SYNC);
+                    #endif
+                }
+            }
+        };
+    }
+
+
+    // MMR<store_t> is an append-only Merkle Mountain Range over sha<256>.
+    // Leaves are hashed as H(0x00 || record) and nodes as H(0x01 || left ||
+    // right), as in RFC 6962. An append writes the leaf and merges it with
+    // the peaks of equal height, one merge per trailing one bit of the old
+    // leaf count, so it costs O(log n) and reads nothing but peaks. The root
+    // bags the peaks from right to left and binds the leaf count:
+    // H(0x02 || le64(n) || bag)
+
+    template<class store_t = mmr::Memory>
+    class MMR
+    {
+        store_t         m_store;
+        size_t          m_count;
+
+
+        // peak() is the position of the peak of height h whose tree starts
+        // at position start
+
+        static constexpr size_t
+        peak(const size_t &start, const size_t &h)
+        {
+            return start + (size_t(2) << h) - 2;
+        }
+
+
+    public:
+
+        template<class... args_t>
+        explicit MMR(args_t&&... args) : m_store(std::forward<args_t>(args)...)
+        {
+            const size_t count = mmr::leaves(this->m_store.size());
+            this->m_count = count == SIZE_MAX ? 0 : count;
+        }
+
+
+        store_t&
+        store()
+        {
+            return this->m_store;
+        }
+
+
+        const store_t&
+        store() const
+        {
+            return this->m_store;
+        }
+
+
+        size_t
+        size() const
+        {
+            return this->m_count;
+        }
+
+
+        static Number<256>
+        leaf(const void *record, const size_t &length)
+        {
+            const uint8_t prefix = 0x00;
+            return hasher::SHA<256>().update({ { &prefix, 1 }, { record, length } }).digest();
+        }
+
+
+        static Number<256>
+        node(const Number<256> &left, const Number<256> &right)
+        {
+            const uint8_t prefix = 0x01;
+            return hasher::SHA<256>().update({ { &prefix, 1 }, { left.data(), left.size() }, { right.data(), right.size() } }).digest();
+        }
+
+
+        // append() returns the index of the new leaf, or SIZE_MAX when the
+        // store cannot grow
+
+        size_t
+        append(const void *record, const size_t &length)
+        {
+            return this->push(leaf(record, length));
+        }
+
+
+        size_t
+        push(const Number<256> &hash)
+        {
+            Number<256> top = hash;
+            size_t      pos = this->m_store.size(), merges = 0;
+
+            while (this->m_count >> merges & 1)
+            {
+                ++merges;
+            }
+
+            if (!this->m_store.reserve(pos + merges + 1))
+            {
+                return SIZE_MAX;
+            }
+
+            this->m_store.push(top);
+
+            for (size_t h = 0; h < merges; ++h, ++pos)
+            {
+                top = node(this->m_store[pos + 1 - (size_t(2) << h)], top);
+                this->m_store.push(top);
+            }
+
+            this->m_store.commit();
+            return this->m_count++;
+        }
+
+
+        std::vector<Number<256>>
+        peaks() const
+        {
+            std::vector<Number<256>> result;
+
+            for (size_t h = sizeof(size_t) * CHAR_BIT, start = 0; h--;)
+            {
+                if (this->m_count >> h & 1)
+                {
+                    result.push_back(this->m_store[peak(start, h)]);
+                    start += (size_t(2) << h) - 1;
+                }
+            }
+
+            return result;
+        }
+
+
+        static Number<256>
+        bag(const std::vector<Number<256>> &peaks, const size_t &count)
+        {
+            uint8_t     header[9] = { 0x02 };
+            Number<256> top;
+
+            for (size_t i = peaks.size(); i--;)
+            {
+                top = i + 1 == peaks.size() ? peaks[i] : node(peaks[i], top);
+            }
+
+            for (size_t i = 0; i < 8; ++i)
+            {
+                header[1 + i] = uint8_t(uint64_t(count) >> (8 * i));
+            }
+
+            return hasher::SHA<256>().update({ { header, sizeof(header) }, { top.data(), peaks.empty() ? 0 : top.size() } }).digest();
+        }
+
+
+        Number<256>
+        root() const
+        {
+            return bag(this->peaks(), this->m_count);
+        }
+
+
+        // proof() walks down from the peak over the leaf, taking the other
+        // child at every level; an index past the end gives an empty proof
+
+        mmr::Proof
+        proof(const size_t &index) const
+        {
+            mmr::Proof result;
+
+            if (index >= this->m_count)
+            {
+                return result;
+            }
+
+            result.peaks = this->peaks();
+
+            for (size_t h = sizeof(size_t) * CHAR_BIT, start = 0, first = 0; h--;)
+            {
+                if (this->m_count >> h & 1)
+                {
+                    if (index < first + (size_t(1) << h))
+                    {
+                        for (size_t k = h, p = peak(start, h), j = index - first; k; --k)
+                        {
+                            const size_t left = p - (size_t(1) << k), right = p - 1;
+
+                            result.path.push_back(this->m_store[j >> (k - 1) & 1 ? left : right]);
+                            p = j >> (k - 1) & 1 ? right : left;
+                        }
+
+                        std::reverse(result.path.begin(), result.path.end());
+                        break;
+                    }
+
+                    start += (size_t(2) << h) - 1;
+                    first += size_t(1) << h;
+                }
+            }
+
+            return result;
+        }
+
+
+        // verify() rebuilds the peak over the leaf from the path, checks it
+        // against the peaks in the proof and bags them into the root
+
+        static bool
+        verify(Number<256> hash, const size_t &index, const size_t &count, const mmr::Proof &proof, const Number<256> &root)
+        {
+            size_t peaks = 0;
+
+            for (size_t n = count; n; n &= n - 1)
+            {
+                ++peaks;
+            }
+
+            if (index >= count || proof.peaks.size() != peaks)
+            {
+                return false;
+            }
+
+            for (size_t h = sizeof(size_t) * CHAR_BIT, m = 0, first = 0; h--;)
+            {
+                if (count >> h & 1)
+                {
+                    if (index < first + (size_t(1) << h))
+                    {
+                        if (proof.path.size() != h)
+                        {
+                            return false;
+                        }
+
+                        for (size_t k = 0, j = index - first; k < h; ++k)
+                        {
+                            hash = j >> k & 1 ? node(proof.path[k], hash) : node(hash, proof.path[k]);
+                        }
+
+                        return hash == proof.peaks[m] && bag(proof.peaks, count) == root;
+                    }
+
+                    first += size_t(1) << h;
+                    ++m;
+                }
+            }
+
+            return false;
+        }
+    };
+}
@@ -24,13 +24,35 @@
  */
 
 #pragma once
+#include <array>
+#include <cmath>
 #include <climits>
 #include <assert.h>
 #include <initializer_list>
 #include "crypto/string.h"
 
+// Number wipes itself when destroyed, which keeps it from being a literal
+// type before C++20. From C++20 on its destructor and basic members are
+// constexpr, so numbers can also be built in constant expressions
+
+#if defined(__cpp_constexpr) && __cpp_constexpr >= 201907L
+    #define CRYPTO_CONSTEXPR constexpr
+#else
+    #define CRYPTO_CONSTEXPR
+#endif
+
 namespace crypto
 {
+    // compiling() is true while the compiler evaluates a constant expression,
+    // so constexpr code can leave intrinsics and memcpy to the runtime path
+
+    constexpr bool
+    compiling()
+    {
+        return __builtin_is_constant_evaluated();
+    }
+
+
     template<size_t BITS, typename word_t = uint8_t>
     class Number
     {
@@ -44,24 +66,54 @@ namespace crypto
 
      public:
 
+        CRYPTO_CONSTEXPR
         Number() : m_data{}
         {
         }
 
 
+        CRYPTO_CONSTEXPR
         Number(const std::initializer_list<word_t> &object)
         {
+            if (compiling())
+            {
+                for (size_t i = 0; i < BINS; ++i)
+                {
+                    this->m_data[i] = i < object.size() ? object.begin()[i] : word_t(0);
+                }
+
+                return;
+            }
+
             memcpy(this->data(), object.begin(), object.size() * sizeof(word_t));
         }
 
 
+        CRYPTO_CONSTEXPR
         Number(const word_t *record, const size_t &length = BINS) : m_data{}
         {
             assert(this->size()       >= length * sizeof(word_t));
+
+            if (compiling())
+            {
+                for (size_t i = 0; i < length; ++i)
+                {
+                    this->m_data[i] = record[i];
+                }
+
+                return;
+            }
+
             memcpy(this->data(), record, length * sizeof(word_t));
         }
 
 
+        CRYPTO_CONSTEXPR
+        Number(const std::array<word_t, BINS> &object) : Number(object.data())
+        {
+        }
+
+
         template<size_t length, typename type_t>
         Number(const Number<length, type_t> &number) : m_data{}
         {
@@ -83,41 +135,45 @@ namespace crypto
         }
 
 
+        CRYPTO_CONSTEXPR
        ~Number()
         {
-            memset(this->data(), 0, this->size());
+            if (!compiling())
+            {
+                memset(this->data(), 0, this->size());
+            }
         }
 
 
-        size_t
+        CRYPTO_CONSTEXPR size_t
         bits() const
         {
             return BITS;
         }
 
 
-        size_t
+        CRYPTO_CONSTEXPR size_t
         bins() const
         {
             return BINS;
         }
 
 
-        size_t
+        CRYPTO_CONSTEXPR size_t
         size() const
         {
             return SIZE;
         }
 
 
-        word_t*
+        CRYPTO_CONSTEXPR word_t*
         data()
         {
             return this->m_data;
         }
 
 
-        const word_t*
+        CRYPTO_CONSTEXPR const word_t*
         data() const
         {
             return this->m_data;
@@ -127,14 +183,14 @@ namespace crypto
         // ::sub
 
 
-        word_t&
+        CRYPTO_CONSTEXPR word_t&
         operator[](const size_t &offset)
         {
             return this->m_data[offset];
         }
 
 
-        const word_t&
+        CRYPTO_CONSTEXPR const word_t&
         operator[](const size_t &offset) const
         {
             return this->m_data[offset];
@@ -262,9 +318,19 @@ namespace crypto
         // ::eql
 
 
-        friend bool
+        friend CRYPTO_CONSTEXPR bool
         operator==(const Number &lvalue, const Number &rvalue)
         {
+            if (compiling())
+            {
+                for (size_t i = 0; i < BINS; ++i)
+                {
+                    if (lvalue[i] != rvalue[i]) return false;
+                }
+
+                return true;
+            }
+
             return memcmp(lvalue.data(), rvalue.data(), rvalue.size()) == 0;
         }
 
@@ -272,10 +338,10 @@ namespace crypto
         // ::neq
 
 
-        friend bool
+        friend CRYPTO_CONSTEXPR bool
         operator!=(const Number &lvalue, const Number &rvalue)
         {
-            return memcmp(lvalue.data(), rvalue.data(), rvalue.size()) != 0;
+            return !(lvalue == rvalue);
         }
 
 
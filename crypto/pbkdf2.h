@@ -0,0 +1,304 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Quasis (info@quasis.io)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+#include <vector>
+#include <algorithm>
+#include "crypto/pool.h"
+#include "crypto/hasher/hmac.h"
+
+namespace crypto
+{
+    // PBKDF2<BITS, VITS> derives keys from passwords with HMAC<BITS, VITS>
+    // as in RFC 8018. Every output block is a chain of iterations, each one
+    // an inner and an outer compression from the precomputed key schedule.
+    // Both messages of an iteration are one digest long, so they share one
+    // padded block that is rewritten in place. Independent chains, the
+    // blocks of a long output or the outputs of many passwords, run side by
+    // side in the SIMD lanes of the batch hashers, and a batch of chains is
+    // spread over a thread pool
+
+    template<size_t BITS, size_t VITS = BITS>
+    class PBKDF2
+    {
+        typedef hasher::HMAC<BITS, VITS>              hmac_t;
+        typedef hasher::SHA<BITS, VITS>               core_t;
+        typedef typename hmac_t::Key                  key_t;
+        typedef typename hasher::Option<BITS>::word_t word_t;
+        typedef uint8_t                               byte_t;
+
+        static constexpr size_t STATES = hasher::Option<BITS>::STATES;
+        static constexpr size_t BLOCK  = hasher::Option<BITS>::BLOCKS * sizeof(word_t);
+        static constexpr size_t DIGEST = VITS / CHAR_BIT;
+        static constexpr size_t WORDS  = (DIGEST + sizeof(word_t) - 1) / sizeof(word_t);
+
+        // bytes() is how much of word s belongs to the digest, which is less
+        // than a word for the last one of SHA-512/224
+
+        static constexpr size_t
+        bytes(const size_t &s)
+        {
+            return std::min(sizeof(word_t), DIGEST - s * sizeof(word_t));
+        }
+
+
+    public:
+
+        // chunks of jobs hold up to GRAIN jobs, enough for the widest lanes,
+        // and fewer when that leaves threads of the pool idle
+
+        enum : size_t
+        {
+            GRAIN = 8,
+        };
+
+
+        // Job is one output block: the key schedule and U1 on the way in,
+        // the xor of all iterations on the way out
+
+        struct Job
+        {
+            const key_t  *key;
+            Number<VITS>  block;
+            Number<VITS>  total;
+        };
+
+
+        // Scalar runs one chain through the block kernel of SHA<BITS, VITS>,
+        // which the SHA extensions make faster than the lanes
+
+        struct Scalar
+        {
+            static constexpr size_t LANES  = 1;
+            static constexpr size_t STATES = PBKDF2::STATES;
+
+            typedef PBKDF2::word_t word_t;
+
+
+            void
+            compress(word_t *state, const byte_t *const *block) const
+            {
+                core_t::kernel()(state, block[0], 1);
+            }
+        };
+
+
+        // chains() runs iterations - 1 more iterations of every job, LANES
+        // jobs at a time. Lanes without a job repeat the first job of their
+        // group and are discarded
+
+        template<class engine_t> static void
+        chains(const engine_t &engine, Job *jobs, const size_t &count, const size_t &iterations)
+        {
+            constexpr size_t LANES = engine_t::LANES;
+
+            word_t        state[STATES * LANES], inner[STATES * LANES], outer[STATES * LANES], total[STATES * LANES];
+            byte_t        blocks[LANES][BLOCK];
+            const byte_t *pointers[LANES];
+
+            auto store = [&]()
+            {
+                for (size_t l = 0; l < LANES; ++l)
+                {
+                    for (size_t s = 0; s < WORDS; ++s)
+                    {
+                        const word_t word = h2be(state[s * LANES + l]);
+                        memcpy(blocks[l] + s * sizeof(word_t), &word, bytes(s));
+                    }
+                }
+            };
+
+            for (size_t l = 0; l < LANES; ++l)
+            {
+                const size_t bits = (BLOCK + DIGEST) * CHAR_BIT;
+
+                memset(blocks[l], 0, BLOCK);
+                blocks[l][DIGEST] = 0x80;
+
+                for (size_t k = 0; k < sizeof(size_t); ++k)
+                {
+                    blocks[l][BLOCK - 1 - k] = byte_t(bits >> (8 * k));
+                }
+
+                pointers[l] = blocks[l];
+            }
+
+            for (size_t i = 0; i < count; i += LANES)
+            {
+                const size_t n = std::min(count - i, LANES);
+
+                for (size_t l = 0; l < LANES; ++l)
+                {
+                    const Job &job = jobs[i + (l < n ? l : 0)];
+
+                    for (size_t s = 0; s < STATES; ++s)
+                    {
+                        inner[s * LANES + l] = job.key->inner[s];
+                        outer[s * LANES + l] = job.key->outer[s];
+                    }
+
+                    for (size_t s = 0; s < WORDS; ++s)
+                    {
+                        word_t word = 0;
+                        memcpy(&word, job.block.data() + s * sizeof(word_t), bytes(s));
+                        total[s * LANES + l] = be2h(word);
+                    }
+
+                    memcpy(blocks[l], job.block.data(), DIGEST);
+                }
+
+                for (size_t k = 1; k < iterations; ++k)
+                {
+                    memcpy(state, inner, sizeof(state));
+                    engine.compress(state, pointers);
+                    store();
+
+                    memcpy(state, outer, sizeof(state));
+                    engine.compress(state, pointers);
+                    store();
+
+                    for (size_t s = 0; s < WORDS * LANES; ++s)
+                    {
+                        total[s] ^= state[s];
+                    }
+                }
+
+                for (size_t l = 0; l < n; ++l)
+                {
+                    for (size_t s = 0; s < WORDS; ++s)
+                    {
+                        const word_t word = h2be(total[s * LANES + l]);
+                        memcpy(jobs[i + l].total.data() + s * sizeof(word_t), &word, bytes(s));
+                    }
+                }
+            }
+
+            memset(state, 0, sizeof(state));
+            memset(inner, 0, sizeof(inner));
+            memset(outer, 0, sizeof(outer));
+            memset(total, 0, sizeof(total));
+            memset(blocks, 0, sizeof(blocks));
+        }
+
+
+        // chains() picks the lanes as SHA<BITS, VITS>::batch() does; a
+        // single chain always runs on the scalar kernel
+
+        static void
+        chains(Job *jobs, const size_t &count, const size_t &iterations)
+        {
+            #if defined(CRYPTO_X86)
+                if constexpr (BITS == 256)
+                {
+                    if (count > 1 && cpu().avx2 && !cpu().sha)
+                    {
+                        return chains(hasher::SHA256x8{core_t::SALT.data()}, jobs, count, iterations);
+                    }
+                }
+
+                if constexpr (BITS == 512)
+                {
+                    if (count > 1 && cpu().avx512)
+                    {
+                        return chains(hasher::SHA512x8{core_t::SALT.data()}, jobs, count, iterations);
+                    }
+
+                    if (count > 1 && cpu().avx2)
+                    {
+                        return chains(hasher::SHA512x4{core_t::SALT.data()}, jobs, count, iterations);
+                    }
+                }
+            #endif
+
+            chains(Scalar{}, jobs, count, iterations);
+        }
+
+
+        // derive() fills volume bytes of output for every password, each
+        // with its own salt; outputs follow each other in output. The jobs
+        // of all passwords are shared out over the pool
+
+        static void
+        derive(const Slice *passwords, const Slice *salts, const size_t &iterations,
+               void *output, const size_t &volume, const size_t &count, Pool &pool = Pool::shared())
+        {
+            const size_t       blocks = (volume + DIGEST - 1) / DIGEST;
+            std::vector<key_t> keys(count);
+            std::vector<Job>   jobs(count * blocks);
+
+            assert(iterations > 0);
+
+            pool.run(count, 1, [&](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    keys[i] = key_t(passwords[i].record, passwords[i].length);
+
+                    for (size_t b = 0; b < blocks; ++b)
+                    {
+                        const byte_t index[4] = { byte_t((b + 1) >> 24), byte_t((b + 1) >> 16), byte_t((b + 1) >> 8), byte_t(b + 1) };
+                        Job         &job      = jobs[i * blocks + b];
+
+                        job.key   = &keys[i];
+                        job.block = hmac_t(keys[i]).update({ salts[i], { index, sizeof(index) } }).digest();
+                    }
+                }
+            });
+
+            const size_t grain = std::min(size_t(GRAIN), (jobs.size() + pool.size() - 1) / pool.size());
+
+            pool.run(jobs.size(), grain, [&](size_t begin, size_t end)
+            {
+                chains(jobs.data() + begin, end - begin, iterations);
+            });
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                for (size_t b = 0; b < blocks; ++b)
+                {
+                    const size_t offset = b * DIGEST;
+                    memcpy((byte_t*)output + i * volume + offset, jobs[i * blocks + b].total.data(), std::min(DIGEST, volume - offset));
+                }
+            }
+        }
+    };
+
+
+    template<size_t BITS, size_t VITS = BITS> void
+    pbkdf2(const void *password, const size_t &size, const void *salt, const size_t &length,
+           const size_t &iterations, void *output, const size_t &volume, Pool &pool = Pool::shared())
+    {
+        const Slice passwords[1] = { { password, size } }, salts[1] = { { salt, length } };
+        PBKDF2<BITS, VITS>::derive(passwords, salts, iterations, output, volume, 1, pool);
+    }
+
+
+    template<size_t BITS, size_t VITS = BITS> void
+    pbkdf2(const Slice *passwords, const Slice *salts, const size_t &iterations,
+           void *output, const size_t &volume, const size_t &count, Pool &pool = Pool::shared())
+    {
+        PBKDF2<BITS, VITS>::derive(passwords, salts, iterations, output, volume, count, pool);
+    }
+}
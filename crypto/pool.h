@@ -0,0 +1,227 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Quasis (info@quasis.io)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <exception>
+#include <algorithm>
+#include <functional>
+#include <condition_variable>
+
+namespace crypto
+{
+    // Pool keeps a fixed set of worker threads parked on a condition
+    // variable. run() splits [0, count) into chunks of grain items that the
+    // workers and the calling thread claim from a shared counter, and returns
+    // once every chunk is done; a grain of zero counts as one. Work below
+    // one chunk, or a pool without workers, runs inline on the caller.
+    // Calls to run() are serialized, except that a run() from within a task
+    // of any pool runs inline, so nested parallel code does not wait on
+    // itself. The first exception a task throws, on any thread, skips the
+    // chunks not yet claimed and is rethrown by run() once the others are
+    // done
+
+    class Pool
+    {
+        typedef std::function<void(size_t, size_t)> task_t;
+
+        std::vector<std::thread> m_threads;
+        std::mutex               m_mutex;
+        std::mutex               m_order;
+        std::condition_variable  m_wake;
+        std::condition_variable  m_done;
+        std::atomic<size_t>      m_next;
+        const task_t            *m_task;
+        size_t                   m_count;
+        size_t                   m_grain;
+        size_t                   m_busy;
+        size_t                   m_epoch;
+        bool                     m_stop;
+        std::exception_ptr       m_error;
+
+
+        // inside() is set while a thread runs chunks of some pool
+
+        static bool&
+        inside()
+        {
+            static thread_local bool flag = false;
+            return flag;
+        }
+
+
+        void
+        chunks()
+        {
+            const bool outer = inside();
+
+            inside() = true;
+
+            try
+            {
+                for (size_t begin; (begin = this->m_next.fetch_add(this->m_grain)) < this->m_count;)
+                {
+                    (*this->m_task)(begin, std::min(begin + this->m_grain, this->m_count));
+                }
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(this->m_mutex);
+
+                if (!this->m_error)
+                {
+                    this->m_error = std::current_exception();
+                }
+
+                this->m_next = this->m_count;
+            }
+
+            inside() = outer;
+        }
+
+
+        void
+        work()
+        {
+            for (size_t epoch = 0;;)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(this->m_mutex);
+                    this->m_wake.wait(lock, [&]() { return this->m_stop || this->m_epoch != epoch; });
+
+                    if (this->m_stop)
+                    {
+                        return;
+                    }
+
+                    epoch = this->m_epoch;
+                }
+
+                this->chunks();
+
+                std::lock_guard<std::mutex> lock(this->m_mutex);
+
+                if (--this->m_busy == 0)
+                {
+                    this->m_done.notify_one();
+                }
+            }
+        }
+
+
+    public:
+
+        // threads counts the caller too, so Pool(1) has no workers
+
+        explicit Pool(size_t threads = std::thread::hardware_concurrency())
+            : m_next{ 0 }, m_task{ nullptr }, m_count{ 0 }, m_grain{ 1 }, m_busy{ 0 }, m_epoch{ 0 }, m_stop{ false }
+        {
+            for (size_t i = 1; i < threads; ++i)
+            {
+                this->m_threads.emplace_back(&Pool::work, this);
+            }
+        }
+
+
+        Pool(const Pool&) = delete;
+        Pool& operator=(const Pool&) = delete;
+
+
+       ~Pool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(this->m_mutex);
+                this->m_stop = true;
+            }
+
+            this->m_wake.notify_all();
+
+            for (std::thread &thread : this->m_threads)
+            {
+                thread.join();
+            }
+        }
+
+
+        size_t
+        size() const
+        {
+            return this->m_threads.size() + 1;
+        }
+
+
+        void
+        run(const size_t &count, size_t grain, const task_t &task)
+        {
+            grain = std::max<size_t>(grain, 1);
+
+            if (count <= grain || this->m_threads.empty() || inside())
+            {
+                return count ? task(0, count) : void();
+            }
+
+            std::lock_guard<std::mutex> order(this->m_order);
+
+            {
+                std::lock_guard<std::mutex> lock(this->m_mutex);
+
+                this->m_task  = &task;
+                this->m_count = count;
+                this->m_grain = grain;
+                this->m_busy  = this->m_threads.size();
+                this->m_next  = 0;
+                this->m_epoch++;
+            }
+
+            this->m_wake.notify_all();
+            this->chunks();
+
+            std::unique_lock<std::mutex> lock(this->m_mutex);
+            this->m_done.wait(lock, [&]() { return this->m_busy == 0; });
+
+            if (this->m_error)
+            {
+                std::exception_ptr error = std::move(this->m_error);
+
+                this->m_error = nullptr;
+                lock.unlock();
+                std::rethrow_exception(error);
+            }
+        }
+
+
+        // shared() is the process-wide pool, one thread per hardware thread
+
+        static Pool&
+        shared()
+        {
+            static Pool instance;
+            return instance;
+        }
+    };
+}
@@ -0,0 +1,674 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Quasis (info@quasis.io)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include "crypto/pool.h"
+#include "crypto/hasher/fused.h"
+
+namespace crypto
+{
+    namespace pow
+    {
+        enum : uint64_t
+        {
+            GRAIN  = 1 << 16,
+            NONCES = uint64_t(1) << 32,
+        };
+
+
+        // target() expands the compact "bits" field of a block header into a
+        // 256-bit target, stored little-endian like the hashes it is compared
+        // with. Negative targets are empty and overflowing bytes are dropped
+
+        inline Number<256>
+        target(const uint32_t &bits)
+        {
+            const size_t size = bits >> 24;
+            Number<256>  result;
+
+            if (bits & 0x00800000)
+            {
+                return result;
+            }
+
+            for (size_t i = 0; i < 3; ++i)
+            {
+                if (size + i >= 3 && size + i - 3 < result.size())
+                {
+                    result[size + i - 3] = uint8_t(bits >> (8 * i));
+                }
+            }
+
+            return result;
+        }
+
+
+        // meets() compares a hash with a target as little-endian numbers
+
+        inline bool
+        meets(const Number<256> &hash, const Number<256> &target)
+        {
+            for (size_t i = hash.size(); i--;)
+            {
+                if (hash[i] != target[i])
+                {
+                    return hash[i] < target[i];
+                }
+            }
+
+            return true;
+        }
+
+
+        // Work is everything the nonces of one 80-byte header share: the
+        // state after its first block, the state after the three rounds of
+        // the second block that come before the nonce, and the schedule of
+        // the second block with the nonce word W3 left out. W16 and W17 do
+        // not depend on the nonce and are complete; W18 and W19 lack the
+        // sigma0(W3) and W3 terms. The nonce is stored little-endian at
+        // offset 76, so it enters the schedule byte-swapped
+
+        struct Work
+        {
+            uint8_t     header[80];
+            Number<256> target;
+            uint32_t    limit;
+            uint32_t    midstate[8];
+            uint32_t    state[8];
+            uint32_t    words[20];
+
+
+            Work(const void *record, const Number<256> &goal) : target{ goal }
+            {
+                const uint32_t *salt = hasher::SHA<256>::SALT.data();
+                uint8_t         block[64]{};
+
+                memcpy(this->header, record, sizeof(this->header));
+                memcpy(this->midstate, hasher::SHA<256>::SEED.data(), sizeof(this->midstate));
+                hasher::SHA<256>::kernel()(this->midstate, this->header, 1);
+
+                memcpy(block, this->header + 64, 16);
+                block[16] = 0x80;
+                block[62] = 0x02;
+                block[63] = 0x80;
+
+                for (size_t i = 0; i < 16; ++i)
+                {
+                    uint32_t word;
+                    memcpy(&word, block + 4 * i, sizeof(word));
+                    this->words[i] = be2h(word);
+                }
+
+                this->words[ 3] = 0;
+                this->words[16] = hasher::sigma1(this->words[14]) + this->words[ 9] + hasher::sigma0(this->words[1]) + this->words[0];
+                this->words[17] = hasher::sigma1(this->words[15]) + this->words[10] + hasher::sigma0(this->words[2]) + this->words[1];
+                this->words[18] = hasher::sigma1(this->words[16]) + this->words[11] + this->words[2];
+                this->words[19] = hasher::sigma1(this->words[17]) + this->words[12] + hasher::sigma0(this->words[4]);
+
+                uint32_t a = this->midstate[0], b = this->midstate[1], c = this->midstate[2], d = this->midstate[3];
+                uint32_t e = this->midstate[4], f = this->midstate[5], g = this->midstate[6], h = this->midstate[7];
+
+                hasher::sha2round(a, b, c, d, e, f, g, h, this->words[0] + salt[0]);
+                hasher::sha2round(h, a, b, c, d, e, f, g, this->words[1] + salt[1]);
+                hasher::sha2round(g, h, a, b, c, d, e, f, this->words[2] + salt[2]);
+
+                const uint32_t after[8] = { f, g, h, a, b, c, d, e };
+
+                memcpy(this->state, after, sizeof(this->state));
+                this->limit = uint32_t(goal[28]) | uint32_t(goal[29]) << 8 | uint32_t(goal[30]) << 16 | uint32_t(goal[31]) << 24;
+            }
+
+
+            Number<256>
+            hash(const uint32_t &nonce) const
+            {
+                uint8_t record[80];
+
+                memcpy(record, this->header, 76);
+
+                for (size_t i = 0; i < 4; ++i)
+                {
+                    record[76 + i] = uint8_t(nonce >> (8 * i));
+                }
+
+                return sha256d(record, sizeof(record));
+            }
+
+
+            // check() confirms a nonce whose top 32 bits passed the limit
+
+            bool
+            check(const uint32_t &nonce) const
+            {
+                return meets(this->hash(nonce), this->target);
+            }
+        };
+
+
+        // pow256top() runs sha256d() from the precomputed work up to the
+        // last word of the digest, which holds the top 32 bits of the hash
+        // when read little-endian. That word is the e of round 60 of the
+        // second pass, so its last three rounds are skipped
+
+        inline uint32_t
+        pow256top(const Work &work, const uint32_t &nonce)
+        {
+            const uint32_t *seed = hasher::SHA<256>::SEED.data();
+            const uint32_t *salt = hasher::SHA<256>::SALT.data();
+            const uint32_t  w3   = swap(nonce);
+            uint32_t        w[16];
+
+            memcpy(w, work.words, sizeof(w));
+            w[3] = w3;
+
+            uint32_t a = work.state[0], b = work.state[1], c = work.state[2], d = work.state[3];
+            uint32_t e = work.state[4], f = work.state[5], g = work.state[6], h = work.state[7];
+
+            for (size_t i = 3; i < 64; ++i)
+            {
+                uint32_t &x = w[i & 15];
+
+                if (i >= 20)
+                {
+                    x += hasher::sigma1(w[(i + 14) & 15]) + w[(i + 9) & 15] + hasher::sigma0(w[(i + 1) & 15]);
+                }
+                else if (i >= 16)
+                {
+                    x = work.words[i] + (i == 18 ? hasher::sigma0(w3) : i == 19 ? w3 : 0);
+                }
+
+                const uint32_t t1 = h + hasher::delta1(e) + boop202(e, f, g) + salt[i] + x;
+                const uint32_t t0 = hasher::delta0(a) + boop232(a, b, c);
+
+                h = g; g = f; f = e; e = d + t1;
+                d = c; c = b; b = a; a = t1 + t0;
+            }
+
+            const uint32_t inner[8] =
+            {
+                work.midstate[0] + a, work.midstate[1] + b, work.midstate[2] + c, work.midstate[3] + d,
+                work.midstate[4] + e, work.midstate[5] + f, work.midstate[6] + g, work.midstate[7] + h,
+            };
+
+            memcpy(w, inner, sizeof(inner));
+            memset(w + 8, 0, 32);
+            w[ 8] = 0x80000000;
+            w[15] = 256;
+
+            a = seed[0], b = seed[1], c = seed[2], d = seed[3];
+            e = seed[4], f = seed[5], g = seed[6], h = seed[7];
+
+            for (size_t i = 0; i < 61; ++i)
+            {
+                uint32_t &x = w[i & 15];
+
+                if (i >= 16)
+                {
+                    x += hasher::sigma1(w[(i + 14) & 15]) + w[(i + 9) & 15] + hasher::sigma0(w[(i + 1) & 15]);
+                }
+
+                const uint32_t t1 = h + hasher::delta1(e) + boop202(e, f, g) + salt[i] + x;
+                const uint32_t t0 = hasher::delta0(a) + boop232(a, b, c);
+
+                h = g; g = f; f = e; e = d + t1;
+                d = c; c = b; b = a; a = t1 + t0;
+            }
+
+            return seed[7] + e;
+        }
+
+
+        // scanners
+        //
+        // A scanner looks for the lowest nonce in [first, first + count) whose
+        // hash meets the target of the work. Candidates are picked by the top
+        // 32 bits of the hash and confirmed with a full sha256d(). The SIMD
+        // scanners run eight or sixteen nonces side by side, one per 32-bit
+        // lane, and carry the precomputed work in broadcast registers.
+
+
+        typedef bool (*scan_t)(const Work&, const uint32_t&, const uint32_t&, uint32_t&);
+
+
+        inline bool
+        pow256scalar(const Work &work, const uint32_t &first, const uint32_t &count, uint32_t &nonce)
+        {
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                if (swap(pow256top(work, first + i)) <= work.limit && work.check(first + i))
+                {
+                    return nonce = first + i, true;
+                }
+            }
+
+            return false;
+        }
+
+
+        // pow256kernel() hashes one nonce at a time from the midstate with
+        // the block kernel of SHA<256>. The SHA extensions cannot start in
+        // the middle of a block or stop early, so only the first block is
+        // saved, yet they keep up with eight AVX2 lanes
+
+        inline bool
+        pow256kernel(const Work &work, const uint32_t &first, const uint32_t &count, uint32_t &nonce)
+        {
+            const auto compress = hasher::SHA<256>::kernel();
+            uint8_t    block[64]{}, inner[64];
+
+            memcpy(block, work.header + 64, 12);
+            block[16] = 0x80;
+            block[62] = 0x02;
+            block[63] = 0x80;
+
+            memcpy(inner + 32, hasher::SHA256PAD32, 32);
+
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                uint32_t hash[8];
+
+                for (size_t k = 0; k < 4; ++k)
+                {
+                    block[12 + k] = uint8_t((first + i) >> (8 * k));
+                }
+
+                memcpy(hash, work.midstate, sizeof(hash));
+                compress(hash, block, 1);
+
+                for (size_t k = 0; k < 8; ++k)
+                {
+                    hash[k] = h2be(hash[k]);
+                }
+
+                memcpy(inner, hash, 32);
+                memcpy(hash, hasher::SHA<256>::SEED.data(), sizeof(hash));
+                compress(hash, inner, 1);
+
+                if (swap(hash[7]) <= work.limit && work.check(first + i))
+                {
+                    return nonce = first + i, true;
+                }
+            }
+
+            return false;
+        }
+
+
+        #if defined(CRYPTO_X86)
+            CRYPTO_TARGET("avx2") inline bool
+            pow256avx2(const Work &work, const uint32_t &first, const uint32_t &count, uint32_t &nonce)
+            {
+                const uint32_t *seed = hasher::SHA<256>::SEED.data();
+                const uint32_t *salt = hasher::SHA<256>::SALT.data();
+
+                const __m256i order = _mm256_set_epi64x(
+                    0x0C0D0E0F08090A0BULL, 0x0405060700010203ULL,
+                    0x0C0D0E0F08090A0BULL, 0x0405060700010203ULL);
+
+                const __m256i step  = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+                const __m256i limit = _mm256_set1_epi32(int(work.limit));
+
+                #define ROTR(x, n)\
+                    _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n))
+
+                #define XOR3(x, y, z)\
+                    _mm256_xor_si256(_mm256_xor_si256(x, y), z)
+
+                #define SIGMA0(x)\
+                    XOR3(ROTR(x,  7), ROTR(x, 18), _mm256_srli_epi32(x,  3))
+
+                #define SIGMA1(x)\
+                    XOR3(ROTR(x, 17), ROTR(x, 19), _mm256_srli_epi32(x, 10))
+
+                #define ROUND(i)\
+                {\
+                    const __m256i t1 = _mm256_add_epi32(\
+                        _mm256_add_epi32(h, XOR3(ROTR(e, 6), ROTR(e, 11), ROTR(e, 25))),\
+                        _mm256_add_epi32(\
+                            _mm256_xor_si256(_mm256_and_si256(_mm256_xor_si256(f, g), e), g),\
+                            _mm256_add_epi32(x, _mm256_set1_epi32(int(salt[i])))));\
+                    const __m256i t0 = _mm256_add_epi32(\
+                        XOR3(ROTR(a, 2), ROTR(a, 13), ROTR(a, 22)),\
+                        _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(_mm256_xor_si256(a, b), c)));\
+                    h = g; g = f; f = e; e = _mm256_add_epi32(d, t1);\
+                    d = c; c = b; b = a; a = _mm256_add_epi32(t1, t0);\
+                }
+
+                for (uint32_t base = 0; base < count; base += 8)
+                {
+                    const __m256i w3 = _mm256_shuffle_epi8(_mm256_add_epi32(_mm256_set1_epi32(int(first + base)), step), order);
+                    __m256i       w[16], s[8];
+
+                    for (size_t i = 0; i < 16; ++i)
+                    {
+                        w[i] = _mm256_set1_epi32(int(work.words[i]));
+                    }
+
+                    for (size_t i = 0; i < 8; ++i)
+                    {
+                        s[i] = _mm256_set1_epi32(int(work.state[i]));
+                    }
+
+                    w[3] = w3;
+
+                    __m256i a = s[0], b = s[1], c = s[2], d = s[3];
+                    __m256i e = s[4], f = s[5], g = s[6], h = s[7];
+
+                    for (size_t i = 3; i < 64; ++i)
+                    {
+                        __m256i &x = w[i & 15];
+
+                        if (i >= 20)
+                        {
+                            x = _mm256_add_epi32(_mm256_add_epi32(x, w[(i + 9) & 15]),
+                                _mm256_add_epi32(SIGMA0(w[(i + 1) & 15]), SIGMA1(w[(i + 14) & 15])));
+                        }
+                        else if (i >= 16)
+                        {
+                            x = _mm256_set1_epi32(int(work.words[i]));
+                            x = i == 18 ? _mm256_add_epi32(x, SIGMA0(w3)) : i == 19 ? _mm256_add_epi32(x, w3) : x;
+                        }
+
+                        ROUND(i);
+                    }
+
+                    w[0] = _mm256_add_epi32(a, _mm256_set1_epi32(int(work.midstate[0])));
+                    w[1] = _mm256_add_epi32(b, _mm256_set1_epi32(int(work.midstate[1])));
+                    w[2] = _mm256_add_epi32(c, _mm256_set1_epi32(int(work.midstate[2])));
+                    w[3] = _mm256_add_epi32(d, _mm256_set1_epi32(int(work.midstate[3])));
+                    w[4] = _mm256_add_epi32(e, _mm256_set1_epi32(int(work.midstate[4])));
+                    w[5] = _mm256_add_epi32(f, _mm256_set1_epi32(int(work.midstate[5])));
+                    w[6] = _mm256_add_epi32(g, _mm256_set1_epi32(int(work.midstate[6])));
+                    w[7] = _mm256_add_epi32(h, _mm256_set1_epi32(int(work.midstate[7])));
+
+                    for (size_t i = 8; i < 16; ++i)
+                    {
+                        w[i] = _mm256_set1_epi32(i == 8 ? int(0x80000000) : i == 15 ? 256 : 0);
+                    }
+
+                    a = _mm256_set1_epi32(int(seed[0])), b = _mm256_set1_epi32(int(seed[1]));
+                    c = _mm256_set1_epi32(int(seed[2])), d = _mm256_set1_epi32(int(seed[3]));
+                    e = _mm256_set1_epi32(int(seed[4])), f = _mm256_set1_epi32(int(seed[5]));
+                    g = _mm256_set1_epi32(int(seed[6])), h = _mm256_set1_epi32(int(seed[7]));
+
+                    for (size_t i = 0; i < 61; ++i)
+                    {
+                        __m256i &x = w[i & 15];
+
+                        if (i >= 16)
+                        {
+                            x = _mm256_add_epi32(_mm256_add_epi32(x, w[(i + 9) & 15]),
+                                _mm256_add_epi32(SIGMA0(w[(i + 1) & 15]), SIGMA1(w[(i + 14) & 15])));
+                        }
+
+                        ROUND(i);
+                    }
+
+                    const __m256i top = _mm256_shuffle_epi8(_mm256_add_epi32(e, _mm256_set1_epi32(int(seed[7]))), order);
+                    uint32_t      mask = uint32_t(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_min_epu32(top, limit), top))));
+
+                    for (uint32_t lane = 0; mask; ++lane, mask >>= 1)
+                    {
+                        if ((mask & 1) && base + lane < count && work.check(first + base + lane))
+                        {
+                            return nonce = first + base + lane, true;
+                        }
+                    }
+                }
+
+                #undef ROUND
+                #undef SIGMA1
+                #undef SIGMA0
+                #undef XOR3
+                #undef ROTR
+
+                return false;
+            }
+
+
+            // pow256avx512() is pow256avx2() on sixteen lanes, with vprord
+            // rotations and one vpternlogd per boolean function
+
+            CRYPTO_TARGET("avx512f,avx512bw") inline bool
+            pow256avx512(const Work &work, const uint32_t &first, const uint32_t &count, uint32_t &nonce)
+            {
+                const uint32_t *seed = hasher::SHA<256>::SEED.data();
+                const uint32_t *salt = hasher::SHA<256>::SALT.data();
+
+                const __m512i order = _mm512_set_epi64(
+                    0x0C0D0E0F08090A0BULL, 0x0405060700010203ULL,
+                    0x0C0D0E0F08090A0BULL, 0x0405060700010203ULL,
+                    0x0C0D0E0F08090A0BULL, 0x0405060700010203ULL,
+                    0x0C0D0E0F08090A0BULL, 0x0405060700010203ULL);
+
+                const __m512i step  = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+                const __m512i limit = _mm512_set1_epi32(int(work.limit));
+
+                #define BOOP(x, y, z, table)\
+                    _mm512_ternarylogic_epi32(x, y, z, table)
+
+                #define SIGMA0(x)\
+                    BOOP(_mm512_ror_epi32(x,  7), _mm512_ror_epi32(x, 18), _mm512_srli_epi32(x,  3), 150)
+
+                #define SIGMA1(x)\
+                    BOOP(_mm512_ror_epi32(x, 17), _mm512_ror_epi32(x, 19), _mm512_srli_epi32(x, 10), 150)
+
+                #define ROUND(i)\
+                {\
+                    const __m512i t1 = _mm512_add_epi32(\
+                        _mm512_add_epi32(h, BOOP(_mm512_ror_epi32(e, 6), _mm512_ror_epi32(e, 11), _mm512_ror_epi32(e, 25), 150)),\
+                        _mm512_add_epi32(BOOP(e, f, g, 202), _mm512_add_epi32(x, _mm512_set1_epi32(int(salt[i])))));\
+                    const __m512i t0 = _mm512_add_epi32(\
+                        BOOP(_mm512_ror_epi32(a, 2), _mm512_ror_epi32(a, 13), _mm512_ror_epi32(a, 22), 150),\
+                        BOOP(a, b, c, 232));\
+                    h = g; g = f; f = e; e = _mm512_add_epi32(d, t1);\
+                    d = c; c = b; b = a; a = _mm512_add_epi32(t1, t0);\
+                }
+
+                for (uint32_t base = 0; base < count; base += 16)
+                {
+                    const __m512i w3 = _mm512_shuffle_epi8(_mm512_add_epi32(_mm512_set1_epi32(int(first + base)), step), order);
+                    __m512i       w[16], s[8];
+
+                    for (size_t i = 0; i < 16; ++i)
+                    {
+                        w[i] = _mm512_set1_epi32(int(work.words[i]));
+                    }
+
+                    for (size_t i = 0; i < 8; ++i)
+                    {
+                        s[i] = _mm512_set1_epi32(int(work.state[i]));
+                    }
+
+                    w[3] = w3;
+
+                    __m512i a = s[0], b = s[1], c = s[2], d = s[3];
+                    __m512i e = s[4], f = s[5], g = s[6], h = s[7];
+
+                    for (size_t i = 3; i < 64; ++i)
+                    {
+                        __m512i &x = w[i & 15];
+
+                        if (i >= 20)
+                        {
+                            x = _mm512_add_epi32(_mm512_add_epi32(x, w[(i + 9) & 15]),
+                                _mm512_add_epi32(SIGMA0(w[(i + 1) & 15]), SIGMA1(w[(i + 14) & 15])));
+                        }
+                        else if (i >= 16)
+                        {
+                            x = _mm512_set1_epi32(int(work.words[i]));
+                            x = i == 18 ? _mm512_add_epi32(x, SIGMA0(w3)) : i == 19 ? _mm512_add_epi32(x, w3) : x;
+                        }
+
+                        ROUND(i);
+                    }
+
+                    w[0] = _mm512_add_epi32(a, _mm512_set1_epi32(int(work.midstate[0])));
+                    w[1] = _mm512_add_epi32(b, _mm512_set1_epi32(int(work.midstate[1])));
+                    w[2] = _mm512_add_epi32(c, _mm512_set1_epi32(int(work.midstate[2])));
+                    w[3] = _mm512_add_epi32(d, _mm512_set1_epi32(int(work.midstate[3])));
+                    w[4] = _mm512_add_epi32(e, _mm512_set1_epi32(int(work.midstate[4])));
+                    w[5] = _mm512_add_epi32(f, _mm512_set1_epi32(int(work.midstate[5])));
+                    w[6] = _mm512_add_epi32(g, _mm512_set1_epi32(int(work.midstate[6])));
+                    w[7] = _mm512_add_epi32(h, _mm512_set1_epi32(int(work.midstate[7])));
+
+                    for (size_t i = 8; i < 16; ++i)
+                    {
+                        w[i] = _mm512_set1_epi32(i == 8 ? int(0x80000000) : i == 15 ? 256 : 0);
+                    }
+
+                    a = _mm512_set1_epi32(int(seed[0])), b = _mm512_set1_epi32(int(seed[1]));
+                    c = _mm512_set1_epi32(int(seed[2])), d = _mm512_set1_epi32(int(seed[3]));
+                    e = _mm512_set1_epi32(int(seed[4])), f = _mm512_set1_epi32(int(seed[5]));
+                    g = _mm512_set1_epi32(int(seed[6])), h = _mm512_set1_epi32(int(seed[7]));
+
+                    for (size_t i = 0; i < 61; ++i)
+                    {
+                        __m512i &x = w[i & 15];
+
+                        if (i >= 16)
+                        {
+                            x = _mm512_add_epi32(_mm512_add_epi32(x, w[(i + 9) & 15]),
+                                _mm512_add_epi32(SIGMA0(w[(i + 1) & 15]), SIGMA1(w[(i + 14) & 15])));
+                        }
+
+                        ROUND(i);
+                    }
+
+                    const __m512i top  = _mm512_shuffle_epi8(_mm512_add_epi32(e, _mm512_set1_epi32(int(seed[7]))), order);
+                    uint32_t      mask = uint32_t(_mm512_cmple_epu32_mask(top, limit));
+
+                    for (uint32_t lane = 0; mask; ++lane, mask >>= 1)
+                    {
+                        if ((mask & 1) && base + lane < count && work.check(first + base + lane))
+                        {
+                            return nonce = first + base + lane, true;
+                        }
+                    }
+                }
+
+                #undef ROUND
+                #undef SIGMA1
+                #undef SIGMA0
+                #undef BOOP
+
+                return false;
+            }
+        #endif
+
+
+        // kernel() picks the scanner once, on first use: sixteen AVX-512
+        // lanes run about three times as many nonces as the SHA extensions
+
+        inline scan_t
+        kernel()
+        {
+            static const scan_t instance = []() -> scan_t
+            {
+                #if defined(CRYPTO_X86)
+                    if (cpu().avx512)  return &pow256avx512;
+                    if (cpu().sha)     return &pow256kernel;
+                    if (cpu().avx2)    return &pow256avx2;
+                #endif
+
+                return &pow256scalar;
+            }();
+
+            return instance;
+        }
+
+
+        struct Result
+        {
+            bool        found;
+            uint32_t    nonce;
+            Number<256> hash;
+            uint64_t    hashes;
+            double      seconds;
+
+
+            double
+            rate() const
+            {
+                return this->seconds > 0 ? double(this->hashes) / this->seconds : 0;
+            }
+        };
+
+
+        // search() finds the lowest nonce in [first, first + count) that
+        // makes the header meet the target. The range is cut into chunks of
+        // GRAIN nonces that the pool hands out in order; once a nonce is
+        // found, chunks above it are skipped and the ones still running
+        // stop at their first hit. The result counts the hashes computed and
+        // the time taken, whether a nonce was found or not
+
+        inline Result
+        search(const void *header, const Number<256> &target, const uint64_t &first = 0, const uint64_t &count = NONCES, Pool &pool = Pool::shared())
+        {
+            const auto     start = std::chrono::steady_clock::now();
+            const Work     work(header, target);
+            const scan_t   scan  = kernel();
+            const uint64_t total = first < NONCES ? std::min(count, NONCES - first) : 0;
+
+            std::atomic<uint64_t> best{ NONCES }, hashes{ 0 };
+
+            pool.run(size_t((total + GRAIN - 1) / GRAIN), 1, [&](size_t begin, size_t end)
+            {
+                for (size_t chunk = begin; chunk < end; ++chunk)
+                {
+                    const uint64_t from = first + chunk * GRAIN;
+                    uint32_t       nonce;
+
+                    if (from > best.load())
+                    {
+                        continue;
+                    }
+
+                    const uint32_t size = uint32_t(std::min<uint64_t>(GRAIN, first + total - from));
+                    const bool     hit  = scan(work, uint32_t(from), size, nonce);
+
+                    hashes += hit ? nonce - from + 1 : size;
+
+                    for (uint64_t seen = best.load(); hit && nonce < seen && !best.compare_exchange_weak(seen, nonce);)
+                    {
+                    }
+                }
+            });
+
+            Result result{};
+
+            result.found   = best < NONCES;
+            result.nonce   = result.found ? uint32_t(best) : 0;
+            result.hash    = result.found ? work.hash(result.nonce) : Number<256>();
+            result.hashes  = hashes;
+            result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            return result;
+        }
+    }
+}
@@ -0,0 +1,519 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Quasis (info@quasis.io)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+#include <mutex>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include "crypto/pool.h"
+#include "crypto/arena.h"
+#include "crypto/hasher/sha.h"
+
+namespace crypto
+{
+    namespace smt
+    {
+        typedef std::pair<Number<256>, Number<256>> Entry;
+
+
+        // a proof lists the siblings on the path of a key from the root down
+        // to the first subtree that is empty or holds a single leaf, top
+        // down, and that leaf if there is one. A leaf under another key
+        // proves the key absent, as does an empty subtree
+
+        struct Proof
+        {
+            std::vector<Number<256>> siblings;
+            bool                     leaf;
+            Number<256>              key;
+            Number<256>              value;
+        };
+
+
+        // bit() numbers the bits of a key from the most significant bit of
+        // its first byte, the order in which the tree branches
+
+        inline size_t
+        bit(const Number<256> &key, const size_t &index)
+        {
+            return key[index / CHAR_BIT] >> (CHAR_BIT - 1 - index % CHAR_BIT) & 1;
+        }
+
+
+        // prefix() is the index of the first bit from which two keys differ,
+        // or 256 when they are equal
+
+        inline size_t
+        prefix(const Number<256> &lvalue, const Number<256> &rvalue, const size_t &from = 0)
+        {
+            for (size_t i = from / CHAR_BIT; i < lvalue.size(); ++i)
+            {
+                uint8_t x = lvalue[i] ^ rvalue[i];
+
+                if (i == from / CHAR_BIT)
+                {
+                    x &= uint8_t(0xFF >> (from % CHAR_BIT));
+                }
+
+                for (size_t j = 0; x; ++j, x <<= 1)
+                {
+                    if (x & 0x80) return i * CHAR_BIT + j;
+                }
+            }
+
+            return 256;
+        }
+    }
+
+
+    // SMT is a sparse Merkle tree of depth 256 over sha<256>, mapping keys to
+    // values where a zero value means the key is absent. A subtree of height
+    // h hashes as
+    //
+    //   EMPTY[h]                        when it holds no leaf
+    //   H(0x00 || key || value)         when it holds a single leaf
+    //   H(0x01 || left || right)        otherwise
+    //
+    // with EMPTY[0] = 0 and EMPTY[h] = H(0x01 || EMPTY[h - 1] || EMPTY[h - 1])
+    // precomputed once. Only branch points are stored, so a single leaf never
+    // needs a path of its own and an update rehashes about log2(n) nodes, plus
+    // the levels between a branch and its parent when keys share a prefix.
+    //
+    // update() of a batch sorts the keys, keeps the last value of a repeated
+    // key and walks the tree once, so shared path segments are rehashed once.
+    // The upper levels of large batches are split into independent subtrees
+    // that run on a thread pool; their parents are rehashed afterwards
+
+    class SMT
+    {
+        struct Node
+        {
+            Number<256>     hash;
+            Number<256>     key;
+            Number<256>     value;
+            size_t          depth;
+            Node           *child[2];
+        };
+
+        struct Task
+        {
+            Node              **slot;
+            size_t              depth;
+            const smt::Entry   *lo;
+            const smt::Entry   *hi;
+        };
+
+        enum : size_t
+        {
+            LEAF  = 256,
+            GRAIN =  64,
+        };
+
+        Arena<Node>     m_arena;
+        std::mutex      m_mutex;
+        Node           *m_root;
+        size_t          m_size;
+        Pool           &m_pool;
+
+
+        Node*
+        create(const Number<256> &key, const Number<256> &value, const size_t &depth)
+        {
+            std::lock_guard<std::mutex> lock(this->m_mutex);
+
+            Node *node = this->m_arena.create(Node{ Number<256>(), key, value, depth, { nullptr, nullptr } });
+            this->m_size += depth == LEAF;
+            return node;
+        }
+
+
+        void
+        destroy(Node *node)
+        {
+            std::lock_guard<std::mutex> lock(this->m_mutex);
+
+            this->m_size -= node->depth == LEAF;
+            this->m_arena.destroy(node);
+        }
+
+
+        static Number<256>
+        leaf(const Number<256> &key, const Number<256> &value)
+        {
+            const uint8_t prefix = 0x00;
+            return hasher::SHA<256>().update({ { &prefix, 1 }, { key.data(), key.size() }, { value.data(), value.size() } }).digest();
+        }
+
+
+        static Number<256>
+        combine(const Number<256> &left, const Number<256> &right)
+        {
+            const uint8_t prefix = 0x01;
+            return hasher::SHA<256>().update({ { &prefix, 1 }, { left.data(), left.size() }, { right.data(), right.size() } }).digest();
+        }
+
+
+        // lift() is the hash of the subtree of the given height that holds
+        // nothing but node
+
+        static Number<256>
+        lift(const Node *node, const size_t &height)
+        {
+            if (!node)
+            {
+                return empty(height);
+            }
+
+            Number<256> hash = node->hash;
+
+            for (size_t h = LEAF - node->depth + 1; node->depth < LEAF && h <= height; ++h)
+            {
+                hash = smt::bit(node->key, LEAF - h) ? combine(empty(h - 1), hash) : combine(hash, empty(h - 1));
+            }
+
+            return hash;
+        }
+
+
+        static void
+        rehash(Node *node)
+        {
+            node->hash = combine(lift(node->child[0], LEAF - 1 - node->depth), lift(node->child[1], LEAF - 1 - node->depth));
+        }
+
+
+        // settle() rehashes a branch after its children changed, or replaces
+        // it by the only child left
+
+        void
+        settle(Node **slot)
+        {
+            Node *node = *slot;
+
+            if (node->child[0] && node->child[1])
+            {
+                return rehash(node);
+            }
+
+            *slot = node->child[0] ? node->child[0] : node->child[1];
+            this->destroy(node);
+        }
+
+
+        static const smt::Entry*
+        split(const smt::Entry *lo, const smt::Entry *hi, const size_t &depth)
+        {
+            return std::partition_point(lo, hi, [&](const smt::Entry &entry) { return smt::bit(entry.first, depth) == 0; });
+        }
+
+
+        // build() makes a subtree from sorted entries, dropping zero values
+
+        void
+        build(Node **slot, const smt::Entry *lo, const smt::Entry *hi)
+        {
+            while (lo < hi && lo->second == Number<256>())      ++lo;
+            while (lo < hi && (hi - 1)->second == Number<256>()) --hi;
+
+            if (lo == hi)
+            {
+                *slot = nullptr;
+                return;
+            }
+
+            if (hi - lo == 1)
+            {
+                *slot = this->create(lo->first, lo->second, LEAF);
+                (*slot)->hash = leaf(lo->first, lo->second);
+                return;
+            }
+
+            const size_t      depth = smt::prefix(lo->first, (hi - 1)->first);
+            const smt::Entry *mid   = split(lo, hi, depth);
+
+            *slot = this->create(lo->first, Number<256>(), depth);
+            this->build(&(*slot)->child[0], lo, mid);
+            this->build(&(*slot)->child[1], mid, hi);
+            this->settle(slot);
+        }
+
+
+        // apply() merges sorted entries that all fall under *slot, which
+        // sits below depth bits of common prefix. With tasks given, it only
+        // reshapes the upper levels and queues whole subtrees as tasks, and
+        // the branches it passes through in settles, children first
+
+        void
+        apply(Node **slot, const size_t &depth, const smt::Entry *lo, const smt::Entry *hi,
+              size_t budget = 0, std::vector<Task> *tasks = nullptr, std::vector<Node**> *settles = nullptr)
+        {
+            Node *node = *slot;
+
+            if (lo == hi)
+            {
+                return;
+            }
+
+            if (tasks && (budget == 0 || size_t(hi - lo) < GRAIN || !node || node->depth == LEAF))
+            {
+                tasks->push_back({ slot, depth, lo, hi });
+                return;
+            }
+
+            if (!node)
+            {
+                return this->build(slot, lo, hi);
+            }
+
+            if (node->depth == LEAF)
+            {
+                std::vector<smt::Entry> merged(lo, hi);
+                auto                    match = std::lower_bound(merged.begin(), merged.end(), node->key, [](const smt::Entry &entry, const Number<256> &key)
+                {
+                    return memcmp(entry.first.data(), key.data(), key.size()) < 0;
+                });
+
+                if (match == merged.end() || match->first != node->key)
+                {
+                    merged.insert(match, { node->key, node->value });
+                }
+
+                this->destroy(node);
+                return this->build(slot, merged.data(), merged.data() + merged.size());
+            }
+
+            const size_t common = std::min(smt::prefix(lo->first, node->key, depth), smt::prefix((hi - 1)->first, node->key, depth));
+
+            if (common < node->depth)
+            {
+                Node *fork = this->create(node->key, Number<256>(), common);
+
+                fork->child[smt::bit(node->key, common)] = node;
+                *slot = fork;
+
+                return this->apply(slot, depth, lo, hi, budget, tasks, settles);
+            }
+
+            const smt::Entry *mid = split(lo, hi, node->depth);
+
+            this->apply(&node->child[0], node->depth + 1, lo, mid, budget ? budget - 1 : 0, tasks, settles);
+            this->apply(&node->child[1], node->depth + 1, mid, hi, budget ? budget - 1 : 0, tasks, settles);
+
+            if (settles)
+            {
+                settles->push_back(slot);
+                return;
+            }
+
+            this->settle(slot);
+        }
+
+
+    public:
+
+        SMT(Pool &pool = Pool::shared()) : m_root{ nullptr }, m_size{ 0 }, m_pool(pool)
+        {
+        }
+
+
+        SMT(const SMT&) = delete;
+        SMT& operator=(const SMT&) = delete;
+
+
+        // empty() is the hash of an empty subtree of the given height
+
+        static const Number<256>&
+        empty(const size_t &height)
+        {
+            static const std::vector<Number<256>> table = []()
+            {
+                std::vector<Number<256>> table(LEAF + 1);
+
+                for (size_t h = 1; h <= LEAF; ++h)
+                {
+                    table[h] = combine(table[h - 1], table[h - 1]);
+                }
+
+                return table;
+            }();
+
+            return table[height];
+        }
+
+
+        size_t
+        size() const
+        {
+            return this->m_size;
+        }
+
+
+        Number<256>
+        root() const
+        {
+            return lift(this->m_root, LEAF);
+        }
+
+
+        Number<256>
+        get(const Number<256> &key) const
+        {
+            const Node *node = this->m_root;
+
+            while (node && node->depth < LEAF)
+            {
+                node = node->child[smt::bit(key, node->depth)];
+            }
+
+            return node && node->key == key ? node->value : Number<256>();
+        }
+
+
+        SMT&
+        update(const Number<256> &key, const Number<256> &value)
+        {
+            const smt::Entry entry{ key, value };
+            return this->update(&entry, 1);
+        }
+
+
+        SMT&
+        update(const smt::Entry *entries, const size_t &count)
+        {
+            std::vector<smt::Entry> sorted(entries, entries + count);
+            std::vector<Task>       tasks;
+            std::vector<Node**>     settles;
+            size_t                  budget = 2;
+
+            std::stable_sort(sorted.begin(), sorted.end(), [](const smt::Entry &lvalue, const smt::Entry &rvalue)
+            {
+                return memcmp(lvalue.first.data(), rvalue.first.data(), lvalue.first.size()) < 0;
+            });
+
+            sorted.erase(sorted.begin(), std::unique(sorted.rbegin(), sorted.rend(), [](const smt::Entry &lvalue, const smt::Entry &rvalue)
+            {
+                return lvalue.first == rvalue.first;
+            }).base());
+
+            for (size_t n = this->m_pool.size(); n > 1; n >>= 1)
+            {
+                ++budget;
+            }
+
+            if (this->m_pool.size() == 1 || sorted.size() < GRAIN)
+            {
+                this->apply(&this->m_root, 0, sorted.data(), sorted.data() + sorted.size());
+                return *this;
+            }
+
+            this->apply(&this->m_root, 0, sorted.data(), sorted.data() + sorted.size(), budget, &tasks, &settles);
+
+            this->m_pool.run(tasks.size(), 1, [&](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    this->apply(tasks[i].slot, tasks[i].depth, tasks[i].lo, tasks[i].hi);
+                }
+            });
+
+            for (Node **slot : settles)
+            {
+                this->settle(slot);
+            }
+
+            return *this;
+        }
+
+
+        smt::Proof
+        proof(const Number<256> &key) const
+        {
+            smt::Proof  result{ {}, false, Number<256>(), Number<256>() };
+            const Node *node = this->m_root;
+
+            for (size_t depth = 0; node && node->depth < LEAF; node = node->child[smt::bit(key, node->depth)])
+            {
+                for (; depth < node->depth; ++depth)
+                {
+                    if (smt::bit(key, depth) != smt::bit(node->key, depth))
+                    {
+                        result.siblings.push_back(lift(node, LEAF - 1 - depth));
+                        return result;
+                    }
+
+                    result.siblings.push_back(empty(LEAF - 1 - depth));
+                }
+
+                result.siblings.push_back(lift(node->child[!smt::bit(key, depth)], LEAF - 1 - depth));
+                ++depth;
+            }
+
+            if (node)
+            {
+                result.leaf  = true;
+                result.key   = node->key;
+                result.value = node->value;
+            }
+
+            return result;
+        }
+
+
+        // verify() checks that key maps to value under root, a zero value
+        // checking that the key is absent
+
+        static bool
+        verify(const Number<256> &key, const Number<256> &value, const smt::Proof &proof, const Number<256> &root)
+        {
+            const size_t depth = proof.siblings.size();
+            Number<256>  hash;
+
+            if (depth > LEAF)
+            {
+                return false;
+            }
+
+            if (value != Number<256>() && !(proof.leaf && proof.key == key && proof.value == value))
+            {
+                return false;
+            }
+
+            if (value == Number<256>() && proof.leaf && (proof.key == key || smt::prefix(proof.key, key) < depth))
+            {
+                return false;
+            }
+
+            hash = proof.leaf ? leaf(proof.key, proof.value) : empty(LEAF - depth);
+
+            for (size_t i = depth; i--;)
+            {
+                hash = smt::bit(key, i) ? combine(proof.siblings[i], hash) : combine(hash, proof.siblings[i]);
+            }
+
+            return hash == root;
+        }
+    };
+}
@@ -1,12 +1,30 @@
 #include <time.h>
 #include <string>
 #include <limits>
+#include <map>
+#include <vector>
+#include <functional>
 #include <iostream>
 #include <openssl/sha.h>
 #include <openssl/ripemd.h>
+#include <openssl/hmac.h>
+#include <openssl/evp.h>
+#include "src/arena.h"
+#include "src/merkle.h"
+#include "src/mmr.h"
+#include "src/smt.h"
+#include "src/pow.h"
+#include "src/pbkdf2.h"
+#include "src/hkdf.h"
+#include "src/argon2.h"
 #include "src/number.h"
 #include "src/hasher/sha.h"
 #include "src/hasher/rmd.h"
+#include "src/hasher/fused.h"
+#include "src/hasher/tree.h"
+#include "src/hasher/hmac.h"
+#include "src/hasher/blake2.h"
+#include "src/hasher/keccak.h"
 
 using namespace crypto;
 typedef void(*test_t)();
@@ -68,6 +86,78 @@ static test_t TESTS[] =
     },
 
 
+    []( /* Arena */ )
+    {
+        Arena<hasher::SHA<256>, 64>  arena;
+        std::vector<hasher::SHA<256>*> streams;
+        String<>                       string;
+
+        for (size_t i = 0; i < 1000; ++i)
+        {
+            string += char(rand() % std::numeric_limits<char>::max());
+            streams.push_back(arena.create());
+
+            TEST(size_t(streams.back()) % alignof(hasher::SHA<256>) == 0);
+        }
+
+        for (size_t i = 0; i < string.size(); ++i)
+        {
+            for (size_t j = i; j < streams.size(); ++j)
+            {
+                streams[j]->update(string[i]);
+            }
+        }
+
+        for (size_t i = 0; i < streams.size(); ++i)
+        {
+            TEST(streams[i]->digest() == (sha<256>(string.substr(0, i + 1))));
+        }
+
+        for (size_t i = 0; i < streams.size(); i += 2)
+        {
+            arena.destroy(streams[i]);
+        }
+
+        TEST(arena.size() == 500 && arena.capacity() == 1024);
+
+        for (size_t i = 0; i < streams.size(); i += 2)
+        {
+            streams[i] = arena.create();
+        }
+
+        TEST(arena.size() == 1000 && arena.capacity() == 1024);
+        TEST(streams[0]->update(string).digest() == sha<256>(string));
+
+        struct Fragile
+        {
+            explicit Fragile(const bool &fail)
+            {
+                if (fail) throw std::runtime_error("fragile");
+            }
+        };
+
+        Arena<Fragile, 4> fragile;
+        size_t            thrown = 0;
+        Fragile          *first  = fragile.create(false), *second = fragile.create(false);
+
+        fragile.destroy(first);
+
+        for (size_t i = 0; i < 2; ++i)
+        {
+            try { fragile.create(true); } catch (const std::runtime_error&) { ++thrown; }
+        }
+
+        TEST(thrown == 2 && fragile.size() == 1 && fragile.create(false) == first);
+
+        try { fragile.create(true); } catch (const std::runtime_error&) { ++thrown; }
+
+        Fragile *third = fragile.create(false);
+
+        TEST(thrown == 3 && (char*)third - (char*)second == (char*)second - (char*)first);
+        TEST(fragile.size() == 3 && fragile.capacity() == 4);
+    },
+
+
     []( /* hasher::SHA */ )
     {
         String<> string;
@@ -120,10 +210,224 @@ static test_t TESTS[] =
             TEST((sha<512, 512>(string)) == sha512(string));
         }
 
+        for (size_t i = 0; i < 100; ++i)
+        {
+            hasher::SHA<256> hasher1;
+            hasher::SHA<512> hasher2;
+            Virtual<hasher::SHA<256>> erased1;
+            Virtual<hasher::SHA<512>> erased2;
+            Hasher<256> &hasher3 = erased1;
+            Hasher<512> &hasher4 = erased2;
+
+            for (size_t j = 0, k; j < string.size(); j += k)
+            {
+                k = std::min(size_t(rand()) % 300, string.size() - j);
+
+                hasher1.update(string.data() + j, k); hasher3.update(string.data() + j, k);
+                hasher2.update(string.data() + j, k); hasher4.update(string.data() + j, k);
+            }
+
+            TEST(hasher1.digest() == sha256(string) && hasher3.digest() == sha256(string));
+            TEST(hasher2.digest() == sha512(string) && hasher4.digest() == sha512(string));
+        }
+
+        for (size_t i = 0; i < string.size(); i += 37)
+        {
+            hasher::SHA<256, 224> hasher1, hasher2;
+            hasher::SHA<512, 384> hasher3, hasher4;
+
+            hasher1.update(string.data(), i);
+            hasher3.update(string.data(), i);
+
+            TEST(hasher2.load(hasher1.save()) && hasher4.load(hasher3.save()));
+            TEST(!hasher2.load(hasher3.save()) && !hasher4.load(hasher1.save()));
+
+            auto hasher5 = hasher2;
+
+            TEST(hasher2.update(string.data() + i, string.size() - i).digest() == sha224(string));
+            TEST(hasher4.update(string.data() + i, string.size() - i).digest() == sha384(string));
+            TEST(hasher5.update(string.data() + i, string.size() - i).digest() == sha224(string));
+        }
+
+        for (size_t i = 0; i < 100; ++i)
+        {
+            std::vector<Slice> slices;
+
+            for (size_t j = 0, k; j < string.size(); j += k)
+            {
+                k = std::min(size_t(rand()) % 200, string.size() - j);
+                slices.push_back({ string.data() + j, k });
+            }
+
+            TEST(hasher::SHA<256>().update(slices.data(), slices.size()).digest() == sha256(string));
+            TEST(hasher::SHA<512>().update(slices.data(), slices.size()).digest() == sha512(string));
+        }
+
+        TEST(hasher::SHA<256>().update({ { "abc", 3 }, { "", 0 }, { "def", 3 } }).digest() == sha256("abcdef"));
+
+        constexpr auto digest1 = hasher::SHA<256>::constant("abc");
+        constexpr auto digest2 = hasher::SHA<512, 384>::constant("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq");
+
+        static_assert(digest1[0] == 0xBA && digest1[31] == 0xAD, "SHA256 constant");
+
+        #if defined(__cpp_constexpr) && __cpp_constexpr >= 201907L
+            static_assert(Number<256>(digest1) == Number<256>(hasher::SHA<256>::constant("abc", 3)), "SHA256 constant");
+        #endif
+        TEST(Number<256>(digest1) == sha256("abc"));
+        TEST(Number<384>(digest2) == sha384("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"));
+
+        for (size_t i = 0; i < 300; i += 7)
+        {
+            TEST(Number<256>(hasher::SHA<256>::constant(string.data(), i)) == sha256(string.substr(0, i)));
+            TEST(Number<512>(hasher::SHA<512>::constant(string.data(), i)) == sha512(string.substr(0, i)));
+        }
+
         PERF("SHA224", 10000, (sha<256, 224>(string)), sha224(string));
         PERF("SHA256", 10000, (sha<256, 256>(string)), sha256(string));
         PERF("SHA384", 10000, (sha<512, 384>(string)), sha384(string));
         PERF("SHA512", 10000, (sha<512, 512>(string)), sha512(string));
+
+        String<> short1 = string.substr(0, 32);
+
+        PERF("SHA256 32B", 100000, (sha<256, 256>(short1)), sha256(short1));
+        PERF("SHA512 32B", 100000, (sha<512, 512>(short1)), sha512(short1));
+
+        hasher::SHA<256> reused;
+        Number<256>      output;
+        SHA256_CTX       handle;
+
+        for (size_t i = 0; i < string.size(); i += 37)
+        {
+            reused.reset().update(string.data(), i).digest(output.data());
+            TEST(output == sha256(string.substr(0, i)));
+        }
+
+        PERF("SHA256 32B reuse", 100000, (reused.reset().update(short1).digest(output.data()), 0),
+            (SHA256_Init(&handle), SHA256_Update(&handle, short1.data(), short1.size()), SHA256_Final(output.data(), &handle)));
+    },
+
+
+    []( /* hasher::SHA kernels */ )
+    {
+        #if defined(CRYPTO_X86)
+            typedef hasher::SHA<256> sha256_t;
+            typedef hasher::SHA<512> sha512_t;
+
+            uint8_t  blocks[128 * 16];
+            uint32_t hash1[8], hash2[8];
+            uint64_t hash3[8], hash4[8];
+
+            for (size_t i = 0; i < sizeof(blocks); ++i)
+            {
+                blocks[i] = uint8_t(rand());
+            }
+
+            auto test256 = [&](void (*kernel)(uint32_t*, const uint32_t*, const uint8_t*, size_t))
+            {
+                for (size_t i = 1; i <= 16; ++i)
+                {
+                    memcpy(hash1, sha256_t::SEED.data(), sizeof(hash1));
+                    memcpy(hash2, sha256_t::SEED.data(), sizeof(hash2));
+
+                    sha256_t::transform(hash1, blocks, i);
+                    kernel(hash2, sha256_t::SALT.data(), blocks, i);
+
+                    TEST(memcmp(hash1, hash2, sizeof(hash1)) == 0);
+                }
+            };
+
+            auto test512 = [&](void (*kernel)(uint64_t*, const uint64_t*, const uint8_t*, size_t))
+            {
+                for (size_t i = 1; i <= 16; ++i)
+                {
+                    memcpy(hash3, sha512_t::SEED.data(), sizeof(hash3));
+                    memcpy(hash4, sha512_t::SEED.data(), sizeof(hash4));
+
+                    sha512_t::transform(hash3, blocks, i);
+                    kernel(hash4, sha512_t::SALT.data(), blocks, i);
+
+                    TEST(memcmp(hash3, hash4, sizeof(hash3)) == 0);
+                }
+            };
+
+            if (cpu().sha)                test256(hasher::sha256ni);
+            if (cpu().ssse3)              test256(hasher::sha256ssse3);
+            if (cpu().ssse3)              test512(hasher::sha512ssse3);
+            if (cpu().avx2 && cpu().bmi2) test256(hasher::sha256avx2);
+            if (cpu().avx2 && cpu().bmi2) test512(hasher::sha512avx2);
+        #endif
+    },
+
+
+    []( /* hasher::SHA batch */ )
+    {
+        std::vector<String<>>    strings(300);
+        std::vector<Slice>       slices;
+        std::vector<Number<256>> digests(strings.size());
+        std::vector<Number<224>> digest2(strings.size());
+        std::vector<Number<384>> digest3(strings.size());
+        std::vector<Number<512>> digest5(strings.size());
+        std::vector<Number<256>> digest6(strings.size());
+
+        auto sha512256 = [](const String<> &string)
+        {
+            uint8_t      result[32];
+            unsigned int length = 0;
+
+            EVP_Digest(string.data(), string.size(), result, &length, EVP_sha512_256(), nullptr);
+            return Number<256>(result);
+        };
+
+        for (size_t i = 0; i < strings.size(); ++i)
+        {
+            for (size_t j = 0; j < (i < 150 ? i : size_t(rand() % 2000)); ++j)
+            {
+                strings[i] += char(rand() % std::numeric_limits<char>::max());
+            }
+
+            slices.push_back({ strings[i].data(), strings[i].size() });
+        }
+
+        sha<256     >(slices.data(), digests.data(), slices.size());
+        sha<256, 224>(slices.data(), digest2.data(), slices.size());
+        sha<512, 384>(slices.data(), digest3.data(), slices.size());
+        sha<512     >(slices.data(), digest5.data(), slices.size());
+        sha<512, 256>(slices.data(), digest6.data(), slices.size());
+
+        for (size_t i = 0; i < strings.size(); ++i)
+        {
+            TEST((sha<256     >(strings[i])) == digests[i]);
+            TEST((sha<256, 224>(strings[i])) == digest2[i]);
+            TEST((sha<512, 384>(strings[i])) == digest3[i]);
+            TEST((sha<512     >(strings[i])) == digest5[i]);
+            TEST(sha512256(strings[i]) == digest6[i]);
+        }
+
+        #if defined(CRYPTO_X86)
+            if (cpu().avx2)
+            {
+                hasher::lanes(hasher::SHA256x8{hasher::SHA<256>::SALT.data()}, hasher::SHA<256>::SEED.data(),
+                              slices.data(), digests.data(), slices.size());
+
+                hasher::lanes(hasher::SHA512x4{hasher::SHA<512>::SALT.data()}, hasher::SHA<512, 384>::SEED.data(),
+                              slices.data(), digest3.data(), slices.size());
+
+                hasher::lanes(hasher::SHA512x4{hasher::SHA<512>::SALT.data()}, hasher::SHA<512, 256>::SEED.data(),
+                              slices.data(), digest6.data(), slices.size());
+
+                for (size_t i = 0; i < strings.size(); ++i)
+                {
+                    TEST((sha<256     >(strings[i])) == digests[i]);
+                    TEST((sha<512, 384>(strings[i])) == digest3[i]);
+                    TEST(sha512256(strings[i]) == digest6[i]);
+                }
+            }
+        #endif
+
+        PERF("SHA256 batch", 100, (sha<256>(slices.data(), digests.data(), slices.size()), 0),
+            [&]() { for (size_t i = 0; i < slices.size(); ++i) digests[i] = sha<256>(strings[i]); return 0; }());
+        PERF("SHA512 batch", 100, (sha<512>(slices.data(), digest5.data(), slices.size()), 0),
+            [&]() { for (size_t i = 0; i < slices.size(); ++i) digest5[i] = sha<512>(strings[i]); return 0; }());
     },
 
 
@@ -149,7 +453,1254 @@ static test_t TESTS[] =
             TEST((rmd<160>(string)) == rmd160(string));
         }
 
+        for (size_t i = 0; i < string.size(); i += 37)
+        {
+            hasher::RMD<160> hasher1, hasher2;
+            String<> record = hasher1.update(string.data(), i).save();
+
+            TEST(hasher2.load(record) && !hasher2.load(record.substr(1)));
+            TEST(hasher2.update(string.data() + i, string.size() - i).digest() == rmd160(string));
+        }
+
+        constexpr auto digest1 = hasher::RMD<160>::constant("abc");
+
+        static_assert(digest1[0] == 0x8E && digest1[19] == 0xFC, "RMD160 constant");
+        TEST(Number<160>(digest1) == rmd160("abc"));
+
+        for (size_t i = 0; i < 300; i += 7)
+        {
+            TEST(Number<160>(hasher::RMD<160>::constant(string.data(), i)) == rmd160(string.substr(0, i)));
+        }
+
         PERF("RMD160", 10000, (rmd<160>(string)), rmd160(string));
+
+        String<> short1 = string.substr(0, 32);
+
+        PERF("RMD160 32B", 100000, (memcpy(&short1[0], rmd<160>(short1).data(), 20), 0), (memcpy(&short1[0], rmd160(short1).data(), 20), 0));
+
+        hasher::RMD<160> reused;
+        Number<160>      output;
+        RIPEMD160_CTX    handle;
+
+        for (size_t i = 0; i < string.size(); i += 37)
+        {
+            reused.reset().update(string.data(), i).digest(output.data());
+            TEST(output == rmd160(string.substr(0, i)));
+        }
+
+        PERF("RMD160 32B reuse", 100000, (reused.reset().update(short1).digest(output.data()), 0),
+            (RIPEMD160_Init(&handle), RIPEMD160_Update(&handle, short1.data(), short1.size()), RIPEMD160_Final(output.data(), &handle)));
+
+        String<> buffer(1 << 16, '\0');
+
+        for (size_t i = 0; i < buffer.size(); ++i)
+        {
+            buffer[i] = char(rand());
+        }
+
+        TEST((rmd<160>(buffer)) == rmd160(buffer));
+        PERF("RMD160 64K", 1000, (rmd<160>(buffer)), rmd160(buffer));
+
+        std::vector<String<>>    strings(300);
+        std::vector<Slice>       slices;
+        std::vector<Number<160>> digests(strings.size());
+
+        for (size_t i = 0; i < strings.size(); ++i)
+        {
+            strings[i] = string.substr(0, i < 150 ? i : size_t(rand()) % string.size());
+            slices.push_back({ strings[i].data(), strings[i].size() });
+        }
+
+        rmd<160>(slices.data(), digests.data(), slices.size());
+
+        for (size_t i = 0; i < strings.size(); ++i)
+        {
+            TEST(digests[i] == rmd160(strings[i]));
+        }
+
+        #if defined(CRYPTO_X86)
+            if (cpu().sse2)
+            {
+                hasher::lanes(hasher::RMD160x4{hasher::RMD<160>::SALT.data(), hasher::RMD<160>::OFFS, hasher::RMD<160>::SIZE},
+                              hasher::RMD<160>::SEED.data(), slices.data(), digests.data(), slices.size());
+
+                for (size_t i = 0; i < strings.size(); ++i)
+                {
+                    TEST(digests[i] == rmd160(strings[i]));
+                }
+            }
+        #endif
+
+        PERF("RMD160 batch", 100, (rmd<160>(slices.data(), digests.data(), slices.size()), 0),
+            [&]() { for (size_t i = 0; i < slices.size(); ++i) digests[i] = rmd160(strings[i]); return 0; }());
+    },
+
+
+    []( /* sha256d, hash160 */ )
+    {
+        String<> string;
+
+        auto sha256d1 = [](const String<> &string) -> Number<256>
+        {
+            Number<256> result;
+
+            SHA256((const uint8_t*)string.data(), string.size(), result.data());
+            return SHA256(result.data(), result.size(), result.data()), result;
+        };
+
+        auto hash1601 = [](const String<> &string) -> Number<160>
+        {
+            Number<256> middle;
+            Number<160> result;
+
+            SHA256((const uint8_t*)string.data(), string.size(), middle.data());
+            return RIPEMD160(middle.data(), middle.size(), result.data()), result;
+        };
+
+        string.reserve(300);
+
+        for (size_t i = 0; i < string.capacity(); ++i)
+        {
+            string += char(rand() % std::numeric_limits<char>::max());
+
+            TEST(sha256d(string) == sha256d1(string));
+            TEST(hash160(string) == hash1601(string));
+        }
+
+        std::vector<String<>>    strings(200);
+        std::vector<Slice>       slices;
+        std::vector<Number<256>> digests(strings.size());
+        std::vector<Number<160>> digest1(strings.size());
+
+        for (size_t i = 0; i < strings.size(); ++i)
+        {
+            strings[i] = string.substr(0, i % 3 ? 32 * (i % 3) : i);
+            slices.push_back({ strings[i].data(), strings[i].size() });
+        }
+
+        sha256d(slices.data(), digests.data(), slices.size());
+        hash160(slices.data(), digest1.data(), slices.size());
+
+        for (size_t i = 0; i < strings.size(); ++i)
+        {
+            TEST(digests[i] == sha256d1(strings[i]));
+            TEST(digest1[i] == hash1601(strings[i]));
+        }
+
+        String<> short1 = string.substr(0, 32), short2 = string.substr(0, 64);
+
+        PERF("SHA256d 32B", 100000, sha256d(short1), sha256d1(short1));
+        PERF("SHA256d 64B", 100000, sha256d(short2), sha256d1(short2));
+        PERF("HASH160 32B", 100000, hash160(short1), hash1601(short1));
+        PERF("SHA256d batch", 100, (sha256d(slices.data(), digests.data(), slices.size()), 0),
+            [&]() { for (size_t i = 0; i < slices.size(); ++i) digests[i] = sha256d1(strings[i]); return 0; }());
+    },
+
+
+    []( /* Merkle */ )
+    {
+        auto bitcoin = [](std::vector<Number<256>> level) -> Number<256>
+        {
+            for (; level.size() > 1; level.resize(level.size() / 2))
+            {
+                if (level.size() % 2) level.push_back(level.back());
+
+                for (size_t i = 0; i < level.size(); i += 2)
+                {
+                    Number<256> middle;
+
+                    SHA256(level[i].data(), 64, middle.data());
+                    SHA256(middle.data(), middle.size(), level[i / 2].data());
+                }
+            }
+
+            return level.empty() ? Number<256>() : level[0];
+        };
+
+        std::function<Number<256>(const Number<256>*, size_t)> rfc6962 = [&](const Number<256> *nodes, size_t count) -> Number<256>
+        {
+            size_t split = 1;
+
+            while (split * 2 < count) split *= 2;
+
+            if (count == 1) return nodes[0];
+
+            uint8_t     block[65] = { 0x01 };
+            Number<256> result;
+
+            memcpy(block +  1, rfc6962(nodes, split).data(), 32);
+            memcpy(block + 33, rfc6962(nodes + split, count - split).data(), 32);
+            return SHA256(block, sizeof(block), result.data()), result;
+        };
+
+        std::vector<String<>>    strings(5000);
+        std::vector<Slice>       slices;
+        std::vector<Number<256>> leaves1, leaves2;
+
+        for (size_t i = 0; i < strings.size(); ++i)
+        {
+            for (size_t j = 1 + rand() % 100; j; --j) strings[i] += char(rand());
+
+            String<> record = String<>(1, '\0') + strings[i];
+            leaves1.push_back(sha256d(strings[i]));
+            leaves2.push_back(sha<256>(record));
+            slices.push_back({ strings[i].data(), strings[i].size() });
+        }
+
+        TEST(Merkle<>(leaves1.data(), 0).root() == Number<256>());
+        TEST(Merkle<merkle::RFC6962>(leaves2.data(), 0).root() == sha<256>("", 0));
+
+        for (size_t count = 1; count <= 40; ++count)
+        {
+            Merkle<>                 tree1(slices.data(), count);
+            Merkle<merkle::RFC6962>  tree2(slices.data(), count);
+            std::vector<Number<256>> nodes1(leaves1.begin(), std::next(leaves1.begin(), ptrdiff_t(count)));
+
+            TEST(tree1.root() == bitcoin(nodes1));
+            TEST(tree2.root() == rfc6962(leaves2.data(), count));
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                auto proof1 = tree1.proof(i), proof2 = tree2.proof(i);
+
+                TEST(Merkle<>::verify(leaves1[i], i, count, proof1, tree1.root()));
+                TEST(Merkle<merkle::RFC6962>::verify(leaves2[i], i, count, proof2, tree2.root()));
+                TEST(Merkle<merkle::RFC6962>::leaf(strings[i].data(), strings[i].size()) == leaves2[i]);
+                TEST(!Merkle<>::verify(leaves1[(i + 1) % count], i, count, proof1, tree1.root()) || count == 1);
+                TEST(!Merkle<merkle::RFC6962>::verify(leaves2[i], i + 1, count, proof2, tree2.root()) || count == 1);
+
+                if (!proof2.empty())
+                {
+                    proof2.back()[0] ^= 1;
+                    TEST(!Merkle<merkle::RFC6962>::verify(leaves2[i], i, count, proof2, tree2.root()));
+                }
+            }
+        }
+
+        Pool pool(4);
+
+        TEST(Merkle<>(leaves1.data(), leaves1.size(), pool).root() == bitcoin(leaves1));
+        TEST(Merkle<merkle::RFC6962>(slices.data(), slices.size(), pool).root() == rfc6962(leaves2.data(), leaves2.size()));
+
+        std::atomic<size_t> nested{ 0 };
+        bool                thrown = false;
+
+        pool.run(8, 1, [&](size_t begin, size_t end)
+        {
+            for (; begin < end; ++begin)
+            {
+                nested += Merkle<>(leaves1.data(), leaves1.size(), pool).root() == bitcoin(leaves1);
+            }
+        });
+
+        try
+        {
+            pool.run(100, 1, [&](size_t begin, size_t) { if (begin == 37) throw std::runtime_error("task"); });
+        }
+        catch (const std::runtime_error &error)
+        {
+            thrown = String<>(error.what()) == "task";
+        }
+
+        pool.run(5, 0, [&](size_t begin, size_t end) { nested += end - begin; });
+
+        TEST(nested == 13 && thrown);
+        TEST(Merkle<>(leaves1.data(), leaves1.size(), pool).root() == bitcoin(leaves1));
+
+        std::vector<Number<256>> leaves3(50000, leaves1[0]);
+
+        PERF("Merkle 50K", 10, Merkle<>(leaves3.data(), leaves3.size()).root(), bitcoin(leaves3));
+    },
+
+
+    []( /* hasher::Tree */ )
+    {
+        String<> buffer(100000, '\0');
+        Pool     pool1(1), pool3(3);
+
+        for (size_t i = 0; i < buffer.size(); ++i)
+        {
+            buffer[i] = char(rand());
+        }
+
+        auto reference = [&](size_t length, size_t chunk) -> Number<256>
+        {
+            std::vector<Slice> slices;
+            uint8_t            header[17] = { 0x02 };
+
+            for (size_t i = 0; i < length || i == 0; i += chunk)
+            {
+                slices.push_back({ buffer.data() + i, std::min(chunk, length - i) });
+            }
+
+            for (size_t i = 0; i < 8; ++i)
+            {
+                header[1 + i] = uint8_t(uint64_t(chunk)  >> (8 * i));
+                header[9 + i] = uint8_t(uint64_t(length) >> (8 * i));
+            }
+
+            Number<256> top = Merkle<merkle::RFC6962>(slices.data(), slices.size(), pool1).root();
+            return hasher::SHA<256>().update({ { header, sizeof(header) }, { top.data(), top.size() } }).digest();
+        };
+
+        for (size_t length : { 0, 1, 1000, 1024, 1025, 4096, 5000, 100000 })
+        {
+            TEST(hasher::Tree<256>(1024, pool1).update(buffer.data(), length).digest() == reference(length, 1024));
+            TEST(hasher::Tree<256>(1024, pool3).update(buffer.data(), length).digest() == reference(length, 1024));
+            TEST(tree<256>(buffer.data(), length, 1000) == reference(length, 1000));
+        }
+
+        for (size_t i = 0; i < 20; ++i)
+        {
+            hasher::Tree<256>      hasher1(700, pool3);
+            hasher::Tree<512, 384> hasher2(700, pool1), hasher3(700, pool3);
+
+            for (size_t j = 0, k; j < buffer.size(); j += k)
+            {
+                k = std::min(size_t(rand()) % 5000, buffer.size() - j);
+                hasher1.update(buffer.data() + j, k);
+                hasher2.update(buffer.data() + j, k);
+                hasher3.update(buffer.data() + j, k);
+            }
+
+            TEST(hasher1.digest() == reference(buffer.size(), 700));
+            TEST(hasher2.digest() == hasher3.digest());
+            TEST(hasher3.reset().update(buffer).digest() == hasher2.digest());
+        }
+
+        String<> large(1 << 24, '\0');
+
+        PERF("Tree256 16M", 10, tree<256>(large.data(), large.size()), sha<256>(large));
+    },
+
+
+    []( /* MMR */ )
+    {
+        std::vector<Number<256>> leaves;
+        MMR<>                    range;
+
+        for (size_t n = 1; n <= 300; ++n)
+        {
+            Number<256> record = sha<256>(leaves.size());
+
+            TEST(range.append(record.data(), record.size()) == n - 1);
+            leaves.push_back(MMR<>::leaf(record.data(), record.size()));
+
+            std::vector<Number<256>> peaks;
+
+            for (size_t h = 64, first = 0; h--;)
+            {
+                if (n >> h & 1)
+                {
+                    peaks.push_back(Merkle<merkle::RFC6962>(leaves.data() + first, size_t(1) << h).root());
+                    first += size_t(1) << h;
+                }
+            }
+
+            TEST(range.size() == n && range.store().size() == 2 * n - peaks.size());
+            TEST(range.peaks() == peaks && range.root() == MMR<>::bag(peaks, n));
+
+            for (size_t i = 0; i < n && (n < 40 || n % 37 == 0); ++i)
+            {
+                mmr::Proof proof = range.proof(i);
+
+                TEST(MMR<>::verify(leaves[i], i, n, proof, range.root()));
+                TEST(!MMR<>::verify(leaves[i], i, n + 1, proof, range.root()));
+                TEST(!MMR<>::verify(leaves[(i + 1) % n], i, n, proof, range.root()) || n == 1);
+
+                if (!proof.path.empty())
+                {
+                    proof.path[0][0] ^= 1;
+                    TEST(!MMR<>::verify(leaves[i], i, n, proof, range.root()));
+                }
+            }
+        }
+
+        const char *path = "index.mmr";
+        std::remove(path);
+
+        {
+            MMR<mmr::Mapped> mapped(path);
+            TEST(mapped.store().valid() && mapped.size() == 0);
+
+            for (size_t i = 0; i < 2000; ++i)
+            {
+                Number<256> record = sha<256>(i);
+                TEST(mapped.append(record.data(), record.size()) == i);
+            }
+        }
+
+        {
+            MMR<mmr::Mapped> mapped(path);
+            MMR<>            memory;
+
+            for (size_t i = 0; i < 3000; ++i)
+            {
+                Number<256> record = sha<256>(i);
+                memory.append(record.data(), record.size());
+
+                if (i == 1999)
+                {
+                    TEST(mapped.size() == 2000 && mapped.root() == memory.root());
+                }
+            }
+
+            for (size_t i = 2000; i < 3000; ++i)
+            {
+                Number<256> record = sha<256>(i);
+                mapped.append(record.data(), record.size());
+            }
+
+            TEST(mapped.root() == memory.root() && mapped.proof(1234).path == memory.proof(1234).path);
+        }
+
+        {
+            MMR<mmr::Mapped> mapped(path);
+            const Number<256> root = mapped.root();
+
+            TEST(!mapped.store().reserve(size_t(1) << (sizeof(size_t) * CHAR_BIT - 8)));
+            TEST(mapped.store().valid() && mapped.size() == 3000 && mapped.root() == root);
+
+            Number<256> record = sha<256>(size_t(3000));
+            TEST(mapped.append(record.data(), record.size()) == 3000);
+        }
+
+        {
+            MMR<mmr::Mapped> mapped(path);
+            TEST(mapped.store().valid() && mapped.size() == 3001);
+        }
+
+        std::remove(path);
+
+        Number<256> record;
+        MMR<>       appends;
+
+        PERF("MMR append", 100000, appends.append(record.data(), record.size()), (sha<256>(record)));
+    },
+
+
+    []( /* SMT */ )
+    {
+        std::map<std::string, Number<256>> state;
+        std::vector<Number<256>>           empty(257);
+
+        auto hash = [](uint8_t prefix, const Number<256> &lvalue, const Number<256> &rvalue) -> Number<256>
+        {
+            uint8_t     block[65] = { prefix };
+            Number<256> result;
+
+            memcpy(block +  1, lvalue.data(), 32);
+            memcpy(block + 33, rvalue.data(), 32);
+            return SHA256(block, sizeof(block), result.data()), result;
+        };
+
+        for (size_t h = 1; h < empty.size(); ++h)
+        {
+            empty[h] = hash(0x01, empty[h - 1], empty[h - 1]);
+        }
+
+        std::function<Number<256>(const smt::Entry*, const smt::Entry*, size_t)> reference = [&](const smt::Entry *lo, const smt::Entry *hi, size_t depth)
+        {
+            const smt::Entry *mid = lo;
+
+            if (hi - lo == 0) return empty[256 - depth];
+            if (hi - lo == 1) return hash(0x00, lo->first, lo->second);
+
+            while (mid < hi && smt::bit(mid->first, depth) == 0) ++mid;
+
+            return hash(0x01, reference(lo, mid, depth + 1), reference(mid, hi, depth + 1));
+        };
+
+        auto root = [&]()
+        {
+            std::vector<smt::Entry> entries;
+
+            for (const auto &entry : state)
+            {
+                entries.push_back({ Number<256>((const uint8_t*)entry.first.data()), entry.second });
+            }
+
+            return reference(entries.data(), entries.data() + entries.size(), 0);
+        };
+
+        auto random = [](size_t prefix) -> Number<256>
+        {
+            Number<256> key;
+
+            for (size_t i = 0; i < key.size(); ++i)
+            {
+                key[i] = i < prefix ? uint8_t(0x5A) : uint8_t(rand());
+            }
+
+            return key;
+        };
+
+        Pool                    pool1(1), pool4(4);
+        SMT                     tree1(pool1), tree2(pool4);
+        std::vector<Number<256>> keys;
+
+        TEST(tree1.root() == empty[256] && tree1.size() == 0);
+
+        for (size_t round = 0; round < 30; ++round)
+        {
+            std::vector<smt::Entry> batch;
+
+            for (size_t i = 0, n = round % 3 ? 1 + rand() % 10 : 300; i < n; ++i)
+            {
+                Number<256> key = keys.empty() || rand() % 3 ? random(rand() % 3 ? 0 : 30) : keys[rand() % keys.size()];
+                Number<256> value = rand() % 4 ? sha<256>(rand()) : Number<256>();
+
+                batch.push_back({ key, value });
+                keys.push_back(key);
+            }
+
+            for (const smt::Entry &entry : batch)
+            {
+                if (entry.second == Number<256>()) state.erase(std::string((const char*)entry.first.data(), 32));
+                else state[std::string((const char*)entry.first.data(), 32)] = entry.second;
+            }
+
+            tree1.update(batch.data(), batch.size());
+            tree2.update(batch.data(), batch.size());
+
+            TEST(tree1.root() == root() && tree2.root() == tree1.root());
+            TEST(tree1.size() == state.size() && tree2.size() == state.size());
+        }
+
+        for (size_t i = 0; i < keys.size(); i += 7)
+        {
+            const Number<256> value = tree1.get(keys[i]);
+            smt::Proof        proof = tree1.proof(keys[i]);
+
+            TEST(SMT::verify(keys[i], value, proof, tree1.root()));
+            TEST(!SMT::verify(keys[i], sha<256>(value), proof, tree1.root()));
+
+            Number<256> other = keys[i];
+            other[31] ^= 1;
+            proof = tree1.proof(other);
+
+            TEST(SMT::verify(other, tree1.get(other), proof, tree1.root()));
+            TEST(tree1.get(other) != Number<256>() || !SMT::verify(other, value, proof, tree1.root()) || value == Number<256>());
+
+            if (!proof.siblings.empty())
+            {
+                proof.siblings.back()[0] ^= 1;
+                TEST(!SMT::verify(other, tree1.get(other), proof, tree1.root()));
+            }
+        }
+
+        std::vector<smt::Entry> batch;
+
+        for (size_t i = 0; i < 1000; ++i)
+        {
+            batch.push_back({ random(0), sha<256>(i) });
+        }
+
+        SMT tree3(pool1), tree4(pool1);
+
+        PERF("SMT 1K batch", 10, tree3.update(batch.data(), batch.size()).size(),
+            [&]() { for (const smt::Entry &entry : batch) tree4.update(entry.first, entry.second); return 0; }());
+    },
+
+
+    []( /* PoW */ )
+    {
+        const char *genesis =
+            "0100000000000000000000000000000000000000000000000000000000000000"
+            "000000003ba3edfd7a7b12b27ac72c3e67768f617fc81bc3888a51323a9fb8aa"
+            "4b1e5e4a29ab5f49ffff001d1dac2b7c";
+
+        uint8_t header[80];
+
+        for (size_t i = 0; i < sizeof(header); ++i)
+        {
+            header[i] = uint8_t(std::stoul(std::string(genesis + 2 * i, 2), nullptr, 16));
+        }
+
+        const uint32_t    nonce  = 2083236893;
+        const Number<256> target = pow::target(0x1d00ffff);
+
+        TEST(target[26] == 0xFF && target[27] == 0xFF && target[28] == 0x00 && target[25] == 0x00);
+        TEST(pow::target(0x03123456)[0] == 0x56 && pow::target(0x02123456)[0] == 0x34 && pow::target(0x01923456) == Number<256>());
+        TEST(pow::meets(sha256d(header, sizeof(header)), target));
+        TEST(!pow::meets(sha256d(header, sizeof(header)), pow::target(0x1b00ffff)));
+
+        std::vector<pow::scan_t> scanners = { pow::pow256scalar, pow::pow256kernel };
+
+        if (cpu().avx2)   scanners.push_back(pow::pow256avx2);
+        if (cpu().avx512) scanners.push_back(pow::pow256avx512);
+
+        for (pow::scan_t scan : scanners)
+        {
+            const pow::Work work(header, target);
+            uint32_t        found = 0;
+
+            TEST(scan(work, nonce - 1000, 2000, found) && found == nonce);
+            TEST(scan(work, nonce - 1003, 1004, found) && found == nonce);
+            TEST(!scan(work, nonce - 1003, 1003, found));
+            TEST(!scan(work, nonce + 1, 1000, found));
+        }
+
+        for (size_t round = 0; round < 4; ++round)
+        {
+            const Number<256> easy = pow::target(round % 2 ? 0x2000ffff : 0x1f00ffff);
+
+            for (size_t i = 0; i < 76; ++i)
+            {
+                header[i] = uint8_t(rand());
+            }
+
+            uint32_t lowest = 1000;
+
+            while (!pow::meets(pow::Work(header, easy).hash(lowest), easy)) ++lowest;
+
+            for (pow::scan_t scan : scanners)
+            {
+                const pow::Work work(header, easy);
+                uint32_t        found = 0;
+
+                TEST(scan(work, 1000, 1 << 20, found) && found == lowest);
+                TEST(scan(work, lowest, 1, found) && found == lowest);
+                TEST(lowest == 1000 || !scan(work, 1000, lowest - 1000, found));
+            }
+        }
+
+        Pool       pool1(1), pool4(4);
+        const auto result1 = pow::search(header, target, 0x10000000, 3 * pow::GRAIN + 5, pool1);
+
+        TEST(!result1.found && result1.hashes == 3 * pow::GRAIN + 5 && result1.rate() > 0);
+
+        for (size_t i = 0; i < 76; ++i)
+        {
+            header[i] = uint8_t(std::stoul(std::string(genesis + 2 * i, 2), nullptr, 16));
+        }
+
+        const auto result2 = pow::search(header, target, nonce - 300000, 400000, pool4);
+        const auto result3 = pow::search(header, pow::target(0x2100ffff), 0xFFFFFFF0, 1000, pool1);
+        const auto result4 = pow::search(header, pow::target(0x1f00ffff), 0, pow::NONCES, pool4);
+
+        TEST(result2.found && result2.nonce == nonce && result2.hash == sha256d(header, sizeof(header)) && result2.hashes <= 400000);
+        TEST(result3.found && result3.nonce == 0xFFFFFFF0 && result3.hashes == 1);
+        TEST(result4.found && pow::meets(result4.hash, pow::target(0x1f00ffff)) && result4.hashes < 100 * pow::GRAIN);
+        TEST(pow::search(header, target, 0xFFFFFFF0, 1000, pool1).hashes == 16);
+        TEST(pow::search(header, target, pow::NONCES, 1000, pool1).hashes == 0);
+
+        PERF("PoW 64K nonces", 10, pow::search(header, Number<256>(), 0, 1 << 16, pool1).hashes,
+            [&]() { for (uint32_t i = 0; i < (1 << 16); ++i) { memcpy(header + 76, &i, 4); sha<256>(sha<256>(header)); } return 0; }());
+    },
+
+
+    []( /* HMAC */ )
+    {
+        auto openssl = [](const EVP_MD *md, const String<> &key, const String<> &message)
+        {
+            uint8_t      result[64];
+            unsigned int length = 0;
+
+            HMAC(md, key.data(), int(key.size()), (const uint8_t*)message.data(), message.size(), result, &length);
+            return String<>((const char*)result, length);
+        };
+
+        auto string = [](const auto &digest)
+        {
+            return String<>((const char*)digest.data(), digest.size());
+        };
+
+        String<> text;
+
+        for (size_t i = 0; i < 400; ++i)
+        {
+            text.push_back(char(rand()));
+        }
+
+        const size_t sizes[] = { 0, 1, 20, 55, 56, 63, 64, 65, 111, 112, 127, 128, 129, 200, 400 };
+
+        for (size_t k : sizes)
+        {
+            const String<> key = text.substr(400 - k);
+
+            hasher::HMAC<256     >::Key key256(key.data(), key.size());
+            hasher::HMAC<256, 224>::Key key224(key.data(), key.size());
+            hasher::HMAC<512, 384>::Key key384(key.data(), key.size());
+            hasher::HMAC<512     >::Key key512(key.data(), key.size());
+
+            for (size_t m : sizes)
+            {
+                const String<> message = text.substr(0, m);
+
+                TEST(string(hmac<256     >(key256, message.data(), message.size())) == openssl(EVP_sha256(), key, message));
+                TEST(string(hmac<256, 224>(key224, message.data(), message.size())) == openssl(EVP_sha224(), key, message));
+                TEST(string(hmac<512, 384>(key384, message.data(), message.size())) == openssl(EVP_sha384(), key, message));
+                TEST(string(hmac<512     >(key512, message.data(), message.size())) == openssl(EVP_sha512(), key, message));
+                TEST(string(hmac<256>(key.data(), key.size(), message.data(), message.size())) == openssl(EVP_sha256(), key, message));
+            }
+        }
+
+        const String<> key = "Jefe", message = "what do ya want for nothing?";
+
+        hasher::HMAC<256> stream(key.data(), key.size());
+        hasher::HMAC<512> stream5(key.data(), key.size());
+
+        for (size_t i = 0; i < text.size(); i += 37)
+        {
+            const Number<256> digest = stream.reset().update(text.data(), i / 2).update(text.data() + i / 2, i - i / 2).digest();
+            const Number<512> digest5 = stream5.reset().update(text.data(), i).digest();
+
+            TEST(string(digest) == openssl(EVP_sha256(), key, text.substr(0, i)));
+            TEST(string(digest5) == openssl(EVP_sha512(), key, text.substr(0, i)));
+
+            hasher::HMAC<256> copy(key.data(), key.size());
+            TEST(copy.load(stream.reset().update(text.data(), i).save()) && copy.update(text.data(), 1).digest() == stream.update(text.data(), 1).digest());
+        }
+
+        TEST(string(stream.reset().update(message).digest()) == openssl(EVP_sha256(), key, message));
+        TEST(hasher::HMAC<256>::verify(hasher::HMAC<256>::Key(key.data(), key.size()), message.data(), message.size(), stream.digest()));
+        TEST(!hasher::HMAC<256>::verify(hasher::HMAC<256>::Key(key.data(), key.size() - 1), message.data(), message.size(), stream.digest()));
+
+        std::vector<hasher::HMAC<256>::Key> keys256;
+        std::vector<hasher::HMAC<512>::Key> keys512;
+        std::vector<Slice>                  slices;
+        std::vector<String<>>               messages;
+
+        for (size_t i = 0; i < 150; ++i)
+        {
+            const size_t k = sizes[rand() % 15];
+            keys256.emplace_back(text.data() + i, k);
+            keys512.emplace_back(text.data() + i, k);
+            messages.push_back(text.substr(i, sizes[rand() % 15]));
+        }
+
+        for (size_t i = 0; i < messages.size(); ++i)
+        {
+            slices.push_back({ messages[i].data(), messages[i].size() });
+        }
+
+        std::vector<Number<256>> digest256(slices.size()), tags256(slices.size());
+        std::vector<Number<512>> digest512(slices.size()), tags512(slices.size());
+        bool                     valid[150];
+
+        for (size_t i = 0; i < slices.size(); ++i)
+        {
+            tags256[i] = hmac<256>(keys256[i], slices[i].record, slices[i].length);
+            tags512[i] = hmac<512>(keys512[i], slices[i].record, slices[i].length);
+        }
+
+        tags256[7][3] ^= 1;
+        tags512[9][0] ^= 1;
+
+        TEST(hasher::HMAC<256>::verify(keys256.data(), slices.data(), tags256.data(), valid, slices.size()) == slices.size() - 1 && !valid[7] && valid[8]);
+        TEST(hasher::HMAC<512>::verify(keys512.data(), slices.data(), tags512.data(), valid, slices.size()) == slices.size() - 1 && !valid[9] && valid[8]);
+
+        tags256[7][3] ^= 1;
+        tags512[9][0] ^= 1;
+
+        #if defined(CRYPTO_X86)
+            if (cpu().avx2)
+            {
+                hasher::HMAC<256>::batch(hasher::SHA256x8{hasher::SHA<256>::SALT.data()}, keys256.data(), slices.data(), digest256.data(), slices.size());
+                hasher::HMAC<512>::batch(hasher::SHA512x4{hasher::SHA<512>::SALT.data()}, keys512.data(), slices.data(), digest512.data(), slices.size());
+
+                TEST(digest256 == tags256 && digest512 == tags512);
+            }
+        #endif
+
+        hasher::Keyring<256> keyring;
+
+        for (size_t i = 0; i < 1000; ++i)
+        {
+            keyring.insert(std::to_string(i), text.data() + i % 300, 32);
+        }
+
+        keyring.insert("42", key.data(), key.size());
+
+        TEST(keyring.size() == 1000);
+        TEST(keyring.verify("42", message.data(), message.size(), stream.digest()));
+        TEST(!keyring.verify("43", message.data(), message.size(), stream.digest()));
+        TEST(keyring.erase("42") && !keyring.erase("42") && !keyring.verify("42", message.data(), message.size(), stream.digest()));
+
+        hasher::HMAC<256>::Key cached(key.data(), key.size());
+
+        PERF("HMAC-SHA256 64B", 100000, hmac<256>(cached, text.data(), 64), hmac<256>(key.data(), key.size(), text.data(), 64));
+        PERF("HMAC-SHA256 batch", 1000, (hasher::HMAC<256>::batch(keys256.data(), slices.data(), digest256.data(), slices.size()), 0),
+            [&]() { for (size_t i = 0; i < slices.size(); ++i) digest256[i] = hasher::HMAC<256>(keys256[i]).update(slices[i].record, slices[i].length).digest(); return 0; }());
+    },
+
+
+    []( /* PBKDF2 */ )
+    {
+        auto openssl = [](const EVP_MD *md, const String<> &password, const String<> &salt, const size_t &iterations, const size_t &volume)
+        {
+            String<> result(volume, '\0');
+
+            PKCS5_PBKDF2_HMAC(password.data(), int(password.size()), (const uint8_t*)salt.data(), int(salt.size()),
+                              int(iterations), md, int(volume), (uint8_t*)&result[0]);
+            return result;
+        };
+
+        String<> output(300, '\0');
+
+        TEST((pbkdf2<256>("password", 8, "salt", 4, 1, &output[0], 32), output.substr(0, 32)) == openssl(EVP_sha256(), "password", "salt", 1, 32));
+        TEST((pbkdf2<256>("password", 8, "salt", 4, 4096, &output[0], 32), output.substr(0, 32)) == openssl(EVP_sha256(), "password", "salt", 4096, 32));
+
+        const size_t volumes[] = { 1, 20, 32, 33, 48, 64, 65, 100, 200, 300 };
+
+        for (size_t volume : volumes)
+        {
+            const String<> password(volume % 7 ? 5 + volume : 150, char('a' + volume % 26)), salt(volume % 40, 's');
+            const size_t   iterations = 1 + volume % 5 * 7;
+
+            TEST((pbkdf2<256     >(password.data(), password.size(), salt.data(), salt.size(), iterations, &output[0], volume), output.substr(0, volume)) == openssl(EVP_sha256(), password, salt, iterations, volume));
+            TEST((pbkdf2<256, 224>(password.data(), password.size(), salt.data(), salt.size(), iterations, &output[0], volume), output.substr(0, volume)) == openssl(EVP_sha224(), password, salt, iterations, volume));
+            TEST((pbkdf2<512, 384>(password.data(), password.size(), salt.data(), salt.size(), iterations, &output[0], volume), output.substr(0, volume)) == openssl(EVP_sha384(), password, salt, iterations, volume));
+            TEST((pbkdf2<512     >(password.data(), password.size(), salt.data(), salt.size(), iterations, &output[0], volume), output.substr(0, volume)) == openssl(EVP_sha512(), password, salt, iterations, volume));
+            TEST((pbkdf2<512, 224>(password.data(), password.size(), salt.data(), salt.size(), iterations, &output[0], volume), output.substr(0, volume)) == openssl(EVP_sha512_224(), password, salt, iterations, volume));
+        }
+
+        TEST((pbkdf2<512, 224>("password", 8, "salt", 4, 1000, &output[0], 28), output.substr(0, 28)) == openssl(EVP_sha512_224(), "password", "salt", 1000, 28));
+
+        std::vector<String<>> passwords, salts;
+        std::vector<Slice>    slices1, slices2;
+
+        for (size_t i = 0; i < 21; ++i)
+        {
+            passwords.push_back(String<>(i * 7 % 150, char('A' + i)));
+            salts.push_back(String<>(i % 9 * 4, char('0' + i)));
+        }
+
+        for (size_t i = 0; i < passwords.size(); ++i)
+        {
+            slices1.push_back({ passwords[i].data(), passwords[i].size() });
+            slices2.push_back({ salts[i].data(), salts[i].size() });
+        }
+
+        Pool     pool1(1), pool4(4);
+        String<> batch1(21 * 40, '\0'), batch4(21 * 40, '\0'), batch5(21 * 40, '\0');
+
+        pbkdf2<256>(slices1.data(), slices2.data(), 100, &batch1[0], 40, slices1.size(), pool1);
+        pbkdf2<256>(slices1.data(), slices2.data(), 100, &batch4[0], 40, slices1.size(), pool4);
+        pbkdf2<512>(slices1.data(), slices2.data(), 100, &batch5[0], 40, slices1.size(), pool4);
+
+        for (size_t i = 0; i < passwords.size(); ++i)
+        {
+            TEST(batch1.substr(40 * i, 40) == openssl(EVP_sha256(), passwords[i], salts[i], 100, 40));
+            TEST(batch4.substr(40 * i, 40) == batch1.substr(40 * i, 40));
+            TEST(batch5.substr(40 * i, 40) == openssl(EVP_sha512(), passwords[i], salts[i], 100, 40));
+        }
+
+        #if defined(CRYPTO_X86)
+            auto lanes = [&](auto engine, auto bits)
+            {
+                typedef PBKDF2<decltype(bits)::value> kdf_t;
+                typedef typename hasher::HMAC<decltype(bits)::value>::Key key_t;
+
+                std::vector<key_t>                 keys;
+                std::vector<typename kdf_t::Job> jobs(passwords.size());
+
+                for (size_t i = 0; i < passwords.size(); ++i)
+                {
+                    keys.emplace_back(passwords[i].data(), passwords[i].size());
+                }
+
+                for (size_t i = 0; i < passwords.size(); ++i)
+                {
+                    const uint8_t index[4] = { 0, 0, 0, 1 };
+
+                    jobs[i].key   = &keys[i];
+                    jobs[i].block = hasher::HMAC<decltype(bits)::value>(keys[i]).update({ slices2[i], { index, 4 } }).digest();
+                }
+
+                kdf_t::chains(engine, jobs.data(), jobs.size(), 100);
+
+                for (size_t i = 0; i < passwords.size(); ++i)
+                {
+                    TEST(String<>((const char*)jobs[i].total.data(), jobs[i].total.size()) ==
+                         openssl(decltype(bits)::value == 256 ? EVP_sha256() : EVP_sha512(), passwords[i], salts[i], 100, jobs[i].total.size()));
+                }
+            };
+
+            if (cpu().avx2)   lanes(hasher::SHA256x8{hasher::SHA<256>::SALT.data()}, std::integral_constant<size_t, 256>());
+            if (cpu().avx2)   lanes(hasher::SHA512x4{hasher::SHA<512>::SALT.data()}, std::integral_constant<size_t, 512>());
+            if (cpu().avx512) lanes(hasher::SHA512x8{hasher::SHA<512>::SALT.data()}, std::integral_constant<size_t, 512>());
+        #endif
+
+        PERF("PBKDF2-SHA256 8x10K", 1, (pbkdf2<256>(slices1.data(), slices2.data(), 10000, &batch1[0], 32, 8, pool1), 0),
+            [&]() { for (size_t i = 0; i < 8; ++i) openssl(EVP_sha256(), passwords[i], salts[i], 10000, 32); return 0; }());
+        PERF("PBKDF2-SHA512 8x10K", 1, (pbkdf2<512>(slices1.data(), slices2.data(), 10000, &batch5[0], 64, 8, pool1), 0),
+            [&]() { for (size_t i = 0; i < 8; ++i) openssl(EVP_sha512(), passwords[i], salts[i], 10000, 64); return 0; }());
+    },
+
+
+    []( /* HKDF */ )
+    {
+        auto bytes = [](const char *hex)
+        {
+            String<> result;
+
+            for (size_t i = 0; hex[i] && hex[i + 1]; i += 2)
+            {
+                result.push_back(char(std::stoul(std::string(hex + i, 2), nullptr, 16)));
+            }
+
+            return result;
+        };
+
+        const String<> ikm1 = bytes("0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b");
+        const String<> salt = bytes("000102030405060708090a0b0c");
+        const String<> info = bytes("f0f1f2f3f4f5f6f7f8f9");
+        String<>       output(255 * 64, '\0');
+
+        const Number<256> prk = HKDF<256>::extract(salt.data(), salt.size(), ikm1.data(), ikm1.size());
+
+        TEST(String<>((const char*)prk.data(), prk.size()) == bytes("077709362c2e32df0ddc3f0dc47bba6390b6c73bb50f9c3122ec844ad7c2b3e5"));
+        TEST(hkdf<256>(salt.data(), salt.size(), ikm1.data(), ikm1.size(), info.data(), info.size(), &output[0], 42));
+        TEST(output.substr(0, 42) == bytes("3cb25f25faacd57a90434f64d0362f2a2d2d0a90cf1a5a4c5db02d56ecc4c5bf34007208d5b887185865"));
+        TEST(hkdf<256>("", 0, ikm1.data(), ikm1.size(), "", 0, &output[0], 42));
+        TEST(output.substr(0, 42) == bytes("8da4e775a563c18f715f802a063c5a31b8a11f5c5ee1879ec3454e5f3c738d2d9d201395faa4b61a96c8"));
+
+        String<> ikm2, salt2, info2;
+
+        for (size_t i = 0; i < 80; ++i)
+        {
+            ikm2.push_back(char(i)), salt2.push_back(char(0x60 + i)), info2.push_back(char(0xB0 + i));
+        }
+
+        TEST(hkdf<256>(salt2.data(), salt2.size(), ikm2.data(), ikm2.size(), info2.data(), info2.size(), &output[0], 82));
+        TEST(output.substr(0, 82) == bytes("b11e398dc80327a1c8e7f78c596a49344f012eda2d4efad8a050cc4c19afa97c59045a99cac7827271cb41c65e590e09da3275600c2f09b8367793a9aca3db71cc30c58179ec3e87c14c01d5c1f3434f1d87"));
+
+        const HKDF<512> master(salt2.data(), salt2.size(), ikm2.data(), ikm2.size());
+        const String<>  prk5 = [&]() { const Number<512> key = HKDF<512>::extract(salt2.data(), salt2.size(), ikm2.data(), ikm2.size()); return String<>((const char*)key.data(), key.size()); }();
+
+        for (size_t volume : { 1, 63, 64, 65, 200, 1000 })
+        {
+            String<> expected, block;
+
+            for (uint8_t i = 1; expected.size() < volume; ++i)
+            {
+                const String<>    message = block + info2 + char(i);
+                const Number<512> digest  = hmac<512>(prk5.data(), prk5.size(), message.data(), message.size());
+
+                block.assign((const char*)digest.data(), digest.size());
+                expected += block;
+            }
+
+            TEST(master.expand(info2.data(), info2.size(), &output[0], volume) && output.substr(0, volume) == expected.substr(0, volume));
+        }
+
+        TEST(!master.expand("", 0, &output[0], 255 * 64 + 1) && master.expand("", 0, &output[0], 255 * 64));
+
+        std::vector<String<>> labels;
+        std::vector<Slice>    slices;
+        String<>              batch(100 * 70, '\0');
+
+        for (size_t i = 0; i < 100; ++i)
+        {
+            labels.push_back("session key " + std::to_string(i) + String<>(i % 90, '.'));
+        }
+
+        for (size_t i = 0; i < labels.size(); ++i)
+        {
+            slices.push_back({ labels[i].data(), labels[i].size() });
+        }
+
+        const HKDF<256> session(salt.data(), salt.size(), ikm1.data(), ikm1.size());
+
+        TEST(session.expand(slices.data(), &batch[0], 70, slices.size()));
+
+        for (size_t i = 0; i < labels.size(); ++i)
+        {
+            TEST(session.expand(labels[i].data(), labels[i].size(), &output[0], 70) && output.substr(0, 70) == batch.substr(70 * i, 70));
+        }
+
+        PERF("HKDF-SHA256 100x32B", 1000, session.expand(slices.data(), &batch[0], 32, slices.size()),
+            [&]() { for (const String<> &label : labels) hkdf<256>(salt.data(), salt.size(), ikm1.data(), ikm1.size(), label.data(), label.size(), &output[0], 32); return 0; }());
+    },
+
+
+    []( /* BLAKE2b */ )
+    {
+        auto openssl = [](const String<> &message)
+        {
+            unsigned char digest[64];
+            unsigned int  length = 0;
+
+            EVP_Digest(message.data(), message.size(), digest, &length, EVP_blake2b512(), nullptr);
+            return String<>((const char*)digest, length);
+        };
+
+        auto string = [](const Number<512> &number)
+        {
+            return String<>((const char*)number.data(), number.size());
+        };
+
+        String<> message;
+
+        for (size_t i = 0; i < 600; ++i)
+        {
+            message.push_back(char(i * 131 + 7));
+        }
+
+        TEST(string(blake2b("abc")) == openssl("abc"));
+
+        for (size_t length : { 0, 1, 63, 64, 111, 112, 127, 128, 129, 255, 256, 257, 384, 599 })
+        {
+            const String<> sample = message.substr(0, length);
+
+            TEST(string(blake2b(sample)) == openssl(sample));
+
+            for (size_t step : { 1, 7, 128, 200 })
+            {
+                hasher::BLAKE2b<> hasher;
+
+                for (size_t offset = 0; offset < length; offset += step)
+                {
+                    hasher.update(sample.data() + offset, std::min(step, length - offset));
+                }
+
+                TEST(string(hasher.digest()) == openssl(sample));
+            }
+
+            for (size_t split : { size_t(0), length / 2, length })
+            {
+                hasher::BLAKE2b<> first, second;
+
+                first.update(sample.data(), split);
+                TEST(second.load(first.save()));
+                TEST(string(second.update(sample.data() + split, length - split).digest()) == openssl(sample));
+            }
+        }
+
+        uint8_t digest[64];
+
+        hasher::BLAKE2b<>::oneshot(message.data(), message.size(), digest, 32);
+        TEST(String<>((const char*)digest, 32) == String<>((const char*)blake2b<256>(message).data(), 32));
+        TEST(!hasher::BLAKE2b<256>().load(hasher::BLAKE2b<>().save()));
+        TEST(!hasher::SHA<512>().load(hasher::BLAKE2b<>().save()));
+
+        PERF("BLAKE2b 600B", 10000, blake2b(message.data(), 600), openssl(message));
+    },
+
+
+    []( /* Argon2 */ )
+    {
+        auto bytes = [](const char *hex)
+        {
+            String<> result;
+
+            for (size_t i = 0; hex[i] && hex[i + 1]; i += 2)
+            {
+                result.push_back(char(std::stoul(std::string(hex + i, 2), nullptr, 16)));
+            }
+
+            return result;
+        };
+
+        const String<> password(32, '\x01'), salt(16, '\x02'), secret(8, '\x03'), data(12, '\x04');
+        String<>       tag(32, '\0');
+        Pool           pool1(1), pool4(4);
+
+        auto derive = [&](const uint32_t &type, Pool &pool)
+        {
+            const bool done = Argon2(3, 32, 4, type, pool).derive(password.data(), password.size(), salt.data(), salt.size(), &tag[0], tag.size(),
+                                                                  secret.data(), secret.size(), data.data(), data.size());
+            return done ? tag : String<>();
+        };
+
+        TEST(derive(argon2::ARGON2D,  pool4) == bytes("512b391b6f1162975371d30919734294f868e3be3984f3c1a13a4db9fabe4acb"));
+        TEST(derive(argon2::ARGON2I,  pool4) == bytes("c814d9d1dc7f37aa13f0d77f2494bda1c8de6b016dd388d29952a4c4672b6ce8"));
+        TEST(derive(argon2::ARGON2ID, pool4) == bytes("0d640df58d78766c08c037a34a8b53c9d01ef0452d75b65eb52520e96b01e659"));
+        TEST(derive(argon2::ARGON2ID, pool1) == bytes("0d640df58d78766c08c037a34a8b53c9d01ef0452d75b65eb52520e96b01e659"));
+
+        String<> output1(100, '\0'), output4(100, '\0');
+
+        TEST(argon2id("password", 8, "somesalt", 8, 2, 4096, 3, &output1[0], 100, pool1));
+        TEST(argon2id("password", 8, "somesalt", 8, 2, 4096, 3, &output4[0], 100, pool4));
+        TEST(output1 == output4);
+        TEST(argon2id("password", 8, "somesalt", 8, 2, 4096, 3, &output4[0], 64, pool4) && output1.substr(0, 64) != output4.substr(0, 64));
+
+        TEST(!argon2id("password", 8, "somesalt", 8, 0, 4096, 1, &output1[0], 32));
+        TEST(!argon2id("password", 8, "somesalt", 8, 1, 4096, 0, &output1[0], 32));
+        TEST(!argon2id("password", 8, "somesalt", 8, 1,   31, 4, &output1[0], 32));
+        TEST(!argon2id("password", 8, "somesalt", 8, 1, 4096, 1, &output1[0], 3));
+
+        #if defined(CRYPTO_X86)
+            if (cpu().avx2)
+            {
+                argon2::Block prev, ref, next1, next2;
+
+                for (size_t round = 0; round < 4; ++round)
+                {
+                    for (size_t i = 0; i < argon2::WORDS; ++i)
+                    {
+                        prev.v[i] = uint64_t(i + 1) * 0x9E3779B97F4A7C15 ^ round;
+                        ref.v[i]  = uint64_t(i + 7) * 0xC2B2AE3D27D4EB4F + round;
+                        next1.v[i] = next2.v[i] = uint64_t(i) << round;
+                    }
+
+                    argon2::fillscalar(prev, ref, next1, round % 2 != 0);
+                    argon2::fillavx2(prev, ref, next2, round % 2 != 0);
+                    TEST(memcmp(next1.v, next2.v, sizeof(next1.v)) == 0);
+
+                    argon2::fillscalar(prev, next1, next1, false);
+                    argon2::fillavx2(prev, next2, next2, false);
+                    TEST(memcmp(next1.v, next2.v, sizeof(next1.v)) == 0);
+                }
+
+                PERF("Argon2 G 100K blocks", 100000, (argon2::fillavx2(prev, ref, next2, true), 0), (argon2::fillscalar(prev, ref, next1, true), 0));
+            }
+        #endif
+
+        PERF("Argon2id 64MiB t=1 p=4", 1, argon2id("password", 8, "somesalt", 8, 1, 65536, 4, &output4[0], 32, pool4),
+                                          argon2id("password", 8, "somesalt", 8, 1, 65536, 4, &output1[0], 32, pool1));
+    },
+
+    []( /* Keccak */ )
+    {
+        auto openssl = [](const EVP_MD *md, const String<> &message, const size_t &volume)
+        {
+            String<>    result(volume, '\0');
+            EVP_MD_CTX *context = EVP_MD_CTX_new();
+
+            EVP_DigestInit_ex(context, md, nullptr);
+            EVP_DigestUpdate(context, message.data(), message.size());
+
+            if (EVP_MD_flags(md) & EVP_MD_FLAG_XOF)
+            {
+                EVP_DigestFinalXOF(context, (unsigned char*)&result[0], volume);
+            }
+            else
+            {
+                EVP_DigestFinal_ex(context, (unsigned char*)&result[0], nullptr);
+            }
+
+            EVP_MD_CTX_free(context);
+            return result;
+        };
+
+        auto string = [](const auto &number)
+        {
+            return String<>((const char*)number.data(), number.size());
+        };
+
+        auto bytes = [](const char *hex)
+        {
+            String<> result;
+
+            for (size_t i = 0; hex[i] && hex[i + 1]; i += 2)
+            {
+                result.push_back(char(std::stoul(std::string(hex + i, 2), nullptr, 16)));
+            }
+
+            return result;
+        };
+
+        String<> message;
+
+        for (size_t i = 0; i < 700; ++i)
+        {
+            message.push_back(char(i * 97 + 3));
+        }
+
+        TEST(string(keccak<256>("")) == bytes("c5d2460186f7233c927e7db2dcc703c0e500b653ca82273b7bfad8045d85a470"));
+        TEST(string(keccak<256>("abc")) == bytes("4e03657aea45a94fc7d47ba826c8d667c0d1e6e33a64a036ec44f58fa12d6c45"));
+
+        for (size_t length : { 0, 1, 71, 72, 73, 135, 136, 137, 167, 168, 169, 300, 699 })
+        {
+            const String<> sample = message.substr(0, length);
+
+            TEST(string(sha3<224>(sample)) == openssl(EVP_sha3_224(), sample, 28));
+            TEST(string(sha3<256>(sample)) == openssl(EVP_sha3_256(), sample, 32));
+            TEST(string(sha3<384>(sample)) == openssl(EVP_sha3_384(), sample, 48));
+            TEST(string(sha3<512>(sample)) == openssl(EVP_sha3_512(), sample, 64));
+            TEST(string(hasher::SHAKE<128>().update(sample).digest()) == openssl(EVP_shake128(), sample, 32));
+            TEST(string(hasher::SHAKE<256>().update(sample).digest()) == openssl(EVP_shake256(), sample, 64));
+
+            for (size_t step : { 1, 13, 136, 200 })
+            {
+                hasher::SHA3<256> hasher;
+
+                for (size_t offset = 0; offset < length; offset += step)
+                {
+                    hasher.update(sample.data() + offset, std::min(step, length - offset));
+                }
+
+                TEST(string(hasher.digest()) == openssl(EVP_sha3_256(), sample, 32));
+            }
+
+            hasher::SHA3<512> first, second;
+
+            first.update(sample.data(), length / 2);
+            TEST(second.load(first.save()));
+            TEST(string(second.update(sample.data() + length / 2, length - length / 2).digest()) == openssl(EVP_sha3_512(), sample, 64));
+        }
+
+        TEST(!hasher::SHA3<256>().load(hasher::Keccak<256>().save()));
+        TEST(!hasher::SHA<256>().load(hasher::SHA3<256>().save()));
+
+        for (size_t volume : { 1, 167, 168, 169, 1000 })
+        {
+            String<> output(volume, '\0'), pieces(volume, '\0');
+            hasher::SHAKE<128> shaker;
+
+            shake<128>(message.data(), 300, &output[0], volume);
+            TEST(output == openssl(EVP_shake128(), message.substr(0, 300), volume));
+
+            shake<256>(message.data(), 300, &output[0], volume);
+            TEST(output == openssl(EVP_shake256(), message.substr(0, 300), volume));
+
+            shaker.update(message.data(), 300);
+
+            for (size_t offset = 0; offset < volume; offset += 50)
+            {
+                shaker.squeeze(&pieces[offset], std::min<size_t>(50, volume - offset));
+            }
+
+            TEST(pieces == openssl(EVP_shake128(), message.substr(0, 300), volume));
+            TEST(string(shaker.digest()) == openssl(EVP_shake128(), message.substr(0, 300), 32));
+        }
+
+        std::vector<Slice>       slices;
+        std::vector<Number<256>> digests(37), digests4(37);
+
+        for (size_t i = 0; i < 37; ++i)
+        {
+            slices.push_back({ message.data() + i, i * 19 % 450 });
+        }
+
+        sha3<256>(slices.data(), digests.data(), slices.size());
+
+        for (size_t i = 0; i < slices.size(); ++i)
+        {
+            TEST(digests[i] == sha3<256>(slices[i].record, slices[i].length));
+        }
+
+        keccak<256>(slices.data(), digests.data(), slices.size());
+        hasher::Keccak<256>::batch(hasher::Keccak1600{17}, slices.data(), digests4.data(), slices.size());
+
+        for (size_t i = 0; i < slices.size(); ++i)
+        {
+            TEST(digests[i] == keccak<256>(slices[i].record, slices[i].length) && digests4[i] == digests[i]);
+        }
+
+        #if defined(CRYPTO_X86)
+            if (cpu().avx2)
+            {
+                std::vector<Number<512>> digests5(37);
+
+                hasher::SHA3<512>::batch(hasher::Keccak1600x4{hasher::Keccak1600::SALT.data(), 9}, slices.data(), digests5.data(), slices.size());
+
+                for (size_t i = 0; i < slices.size(); ++i)
+                {
+                    TEST(string(digests5[i]) == openssl(EVP_sha3_512(), String<>((const char*)slices[i].record, slices[i].length), 64));
+                }
+            }
+        #endif
+
+        const String<> block = message.substr(0, 32);
+
+        PERF("SHA3-256", 100000, sha3<256>(message.data(), message.size()), openssl(EVP_sha3_256(), message, 32));
+        PERF("Keccak-256 32B", 100000, keccak<256>(block.data(), 32), openssl(EVP_sha3_256(), block, 32));
+        PERF("Keccak-256 batch", 1000, (keccak<256>(slices.data(), digests.data(), slices.size()), 0),
+            [&]() { for (const Slice &slice : slices) keccak<256>(slice.record, slice.length); return 0; }());
     },
 
 };